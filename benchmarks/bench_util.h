@@ -0,0 +1,111 @@
+#ifndef _CPPYPLOT_BENCH_UTIL_H_
+#define _CPPYPLOT_BENCH_UTIL_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+  * Shared helpers for the benchmarks. Every result is one JSON object per line, so runs can be
+  * collected with run_benchmarks.sh and compared between commits. The python server shares stdout,
+  * results are appended to the file named by CPPYPLOT_BENCH_RESULTS instead when it is set.
+*/
+namespace bench
+{
+
+using clock_type = std::chrono::steady_clock;
+
+inline double seconds_since(clock_type::time_point start)
+{ return std::chrono::duration<double>(clock_type::now() - start).count(); }
+
+// python used for the server, CPPYPLOT_PYTHON overrides the default
+inline std::string python_path()
+{
+  const char* path = std::getenv("CPPYPLOT_PYTHON");
+  return (path != nullptr) ? std::string(path) : std::string("python3");
+}
+
+// largest payload in bytes, CPPYPLOT_BENCH_MAX_BYTES overrides the default of 1 GB
+inline std::size_t max_bytes()
+{
+  const char* max_str = std::getenv("CPPYPLOT_BENCH_MAX_BYTES");
+  return (max_str != nullptr) ? static_cast<std::size_t>(std::strtoull(max_str, nullptr, 10)) : (std::size_t{1u} << 30u);
+}
+
+// 8 bytes, 64 bytes, ... up to max_bytes()
+inline std::vector<std::size_t> payload_sizes(std::size_t step = 8u)
+{
+  std::vector<std::size_t> sizes;
+  for (std::size_t size = 8u; size <= max_bytes(); size *= step)
+  { sizes.push_back(size); }
+  return sizes;
+}
+
+// prevent the optimizer from removing the benchmarked work
+template<typename T>
+inline void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "g"(&value) : "memory");
+#else
+  static volatile const void* sink;
+  sink = &value;
+#endif
+}
+
+struct percentiles{
+  double p50 = 0.0;
+  double p99 = 0.0;
+  double mean = 0.0;
+};
+
+inline percentiles summarize(std::vector<double> samples)
+{
+  percentiles out;
+  if (samples.empty())
+  { return out; }
+  std::sort(samples.begin(), samples.end());
+  out.p50 = samples[(samples.size() - 1u)/2u];
+  out.p99 = samples[std::min(samples.size() - 1u, (samples.size()*99u)/100u)];
+  for (double sample : samples)
+  { out.mean += sample; }
+  out.mean /= static_cast<double>(samples.size());
+  return out;
+}
+
+// one JSON object per line: {"benchmark": "...", "key": value, ...}
+class result{
+  private:
+    std::stringstream line_;
+  public:
+    explicit result(const std::string& benchmark)
+    { line_ << "{\"benchmark\": \"" << benchmark << "\""; }
+
+    result& add(const std::string& key, const std::string& value)
+    { line_ << ", \"" << key << "\": \"" << value << "\""; return *this; }
+
+    result& add(const std::string& key, const char* value)
+    { return add(key, std::string(value)); }
+
+    template<typename T>
+    result& add(const std::string& key, T value)
+    { line_ << ", \"" << key << "\": " << value; return *this; }
+
+    ~result()
+    {
+      line_ << "}\n";
+      const char* results_path = std::getenv("CPPYPLOT_BENCH_RESULTS");
+      if (results_path != nullptr)
+      { std::ofstream(results_path, std::ios::app) << line_.str(); }
+      std::cout << line_.str() << std::flush;
+    }
+};
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,63 @@
+#include "../include/cppyplot.hpp"
+#include "bench_util.h"
+
+#include <random>
+
+/*
+  Samples per second binned by histogram, histogram2d and hexbin, and the size of what is sent
+  instead of the raw samples. Large inputs are split across hardware_concurrency threads.
+*/
+
+template<typename Bin_t>
+void bench_binning(const std::string& kind, std::size_t n_samples, std::size_t payload_bytes, std::size_t raw_bytes, Bin_t&& bin)
+{
+  bin(); // warm up
+  const std::size_t n_iters = std::max<std::size_t>(3u, (std::size_t{1u} << 26u)/n_samples);
+  auto start = bench::clock_type::now();
+  for (std::size_t i = 0u; i < n_iters; i++)
+  { bin(); }
+  double elapsed = bench::seconds_since(start);
+
+  bench::result("binning")
+    .add("kind", kind)
+    .add("samples", n_samples)
+    .add("iterations", n_iters)
+    .add("ns_per_sample", elapsed*1.0e9/static_cast<double>(n_samples*n_iters))
+    .add("msamples_per_sec", static_cast<double>(n_samples*n_iters)/elapsed*1.0e-6)
+    .add("payload_bytes", payload_bytes)
+    .add("raw_bytes", raw_bytes);
+}
+
+int main()
+{
+  std::mt19937 gen(42u);
+  std::normal_distribution<double> norm(0.0, 2.0);
+  const std::size_t max_samples = std::min<std::size_t>(bench::max_bytes()/(2u*sizeof(double)), std::size_t{1u} << 26u);
+
+  for (std::size_t n_samples = 1024u; n_samples <= max_samples; n_samples *= 32u)
+  {
+    std::vector<double> x(n_samples), y(n_samples);
+    for (std::size_t i = 0u; i < n_samples; i++)
+    {
+      x[i] = norm(gen);
+      y[i] = 0.5*x[i] + norm(gen);
+    }
+
+    Cppyplot::histogram hist(100u, -8.0, 8.0);
+    bench_binning("histogram", n_samples, hist.n_bins()*sizeof(std::uint64_t), n_samples*sizeof(double),
+                  [&](){ hist.add(x); bench::do_not_optimize(hist); });
+
+    Cppyplot::histogram2d heat(200u, -8.0, 8.0, 200u, -8.0, 8.0);
+    bench_binning("histogram2d", n_samples, heat.nx()*heat.ny()*sizeof(std::uint64_t), 2u*n_samples*sizeof(double),
+                  [&](){ heat.add(x, y); bench::do_not_optimize(heat); });
+
+    Cppyplot::hexbin hex(100u, -8.0, 8.0, 58u, -8.0, 8.0);
+    std::vector<double> hx, hy;
+    std::vector<std::uint64_t> hc;
+    hex.add(x, y);
+    hex.cells(hx, hy, hc);
+    bench_binning("hexbin", n_samples, hc.size()*(2u*sizeof(double) + sizeof(std::uint64_t)), 2u*n_samples*sizeof(double),
+                  [&](){ hex.add(x, y); bench::do_not_optimize(hex); });
+  }
+  return EXIT_SUCCESS;
+}
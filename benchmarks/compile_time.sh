@@ -0,0 +1,73 @@
+#!/bin/bash
+# Build time of a project with many translation units including cppyplot.hpp.
+# Generates the project in a temporary directory and measures, for every build mode,
+# a full build and an incremental rebuild after touching one translation unit.
+# usage: compile_time.sh [number of translation units] [results file]
+#   extra cmake arguments (e.g. -DCMAKE_PREFIX_PATH=...) can be passed in CPPYPLOT_CMAKE_ARGS
+set -e
+repo=$(cd "$(dirname "$0")/.." && pwd)
+n_tus=${1:-16}
+results=${2:-compile_time_results.jsonl}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+mkdir -p "$work/src"
+for i in $(seq 0 $((n_tus - 1))); do
+  cat > "$work/src/tu_$i.cpp" <<CPP
+#include <cppyplot.hpp>
+void plot_$i(Cppyplot::cppyplot& pyp)
+{
+  std::vector<double> vec(16, $i.0);
+  std::vector<std::vector<float>> vec_2d(4, std::vector<float>(4, 1.0f));
+  pyp.raw(R"pyp(plt.plot(vec))pyp", _p(vec), _p(vec_2d));
+}
+CPP
+  echo "void plot_$i(Cppyplot::cppyplot& pyp);" >> "$work/src/decls.h"
+done
+{
+  echo "#include <cppyplot.hpp>"
+  echo "#include \"decls.h\""
+  echo "int main() { Cppyplot::cppyplot pyp;"
+  for i in $(seq 0 $((n_tus - 1))); do echo "  plot_$i(pyp);"; done
+  echo "}"
+} > "$work/src/main.cpp"
+
+cat > "$work/CMakeLists.txt" <<CMAKE
+cmake_minimum_required(VERSION 3.16)
+project(cppyplot_compile_time CXX)
+set(CPPYPLOT_BUILD_EXAMPLES OFF CACHE BOOL "" FORCE)
+set(CPPYPLOT_BUILD_BENCHMARKS OFF CACHE BOOL "" FORCE)
+add_subdirectory("$repo" cppyplot)
+file(GLOB sources src/*.cpp)
+add_executable(compile_time \${sources})
+target_link_libraries(compile_time PRIVATE cppyplot::cppyplot)
+if (USE_PCH)
+  target_precompile_headers(compile_time PRIVATE <cppyplot.hpp>)
+endif()
+CMAKE
+
+: > "$results"
+# <mode name> <cmake arguments>
+run_mode() {
+  local mode=$1; shift
+  local build="$work/build_$mode"
+  cmake -S "$work" -B "$build" -DCMAKE_BUILD_TYPE=Release $CPPYPLOT_CMAKE_ARGS "$@" > /dev/null
+  # the compiled component is built once and not part of what is measured
+  cmake --build "$build" --target cppyplot_transport > /dev/null 2>&1 || true
+
+  local start=$(date +%s%N)
+  cmake --build "$build" -j1 > /dev/null
+  local full=$((($(date +%s%N) - start)/1000000))
+
+  touch "$work/src/tu_0.cpp"
+  start=$(date +%s%N)
+  cmake --build "$build" -j1 > /dev/null
+  local incremental=$((($(date +%s%N) - start)/1000000))
+
+  echo "{\"benchmark\": \"compile_time\", \"mode\": \"$mode\", \"translation_units\": $((n_tus + 1)), \"full_build_ms\": $full, \"incremental_ms\": $incremental}" | tee -a "$results"
+}
+
+run_mode header_only       -DCPPYPLOT_COMPILED_LIB=OFF -DUSE_PCH=OFF
+run_mode compiled_lib      -DCPPYPLOT_COMPILED_LIB=ON  -DUSE_PCH=OFF
+run_mode header_only_pch   -DCPPYPLOT_COMPILED_LIB=OFF -DUSE_PCH=ON
+run_mode compiled_lib_pch  -DCPPYPLOT_COMPILED_LIB=ON  -DUSE_PCH=ON
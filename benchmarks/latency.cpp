@@ -0,0 +1,47 @@
+#include "../include/cppyplot.hpp"
+#include "bench_util.h"
+
+/*
+  End-to-end latency from submitting a plot until the server dispatched it and replied,
+  one raw_recv round trip per sample. The server runs headless with a trivial command,
+  so rendering is stubbed out and the numbers are transport + parse + dispatch overhead.
+*/
+
+int main()
+{
+  Cppyplot::cppyplot::set_python_path(bench::python_path());
+  Cppyplot::cppyplot::set_headless(true);
+  Cppyplot::cppyplot::set_stats_interval(0s);
+  Cppyplot::cppyplot pyp;
+
+  const std::size_t max_bytes = std::min<std::size_t>(bench::max_bytes(), std::size_t{1u} << 24u);
+  for (std::size_t n_bytes = 8u; n_bytes <= max_bytes; n_bytes *= 8u)
+  {
+    std::vector<double> payload(n_bytes/sizeof(double), 1.0);
+    const std::size_t n_samples = std::clamp<std::size_t>((std::size_t{1u} << 28u)/n_bytes, 20u, 1000u);
+
+    std::vector<double> round_trip_us;
+    round_trip_us.reserve(n_samples);
+    for (std::size_t sample = 0u; sample < n_samples + 5u; sample++)
+    {
+      int ack = 0;
+      auto start = bench::clock_type::now();
+      pyp.raw_recv(R"pyp(ack = 1)pyp", Cppyplot::outputs(_p(ack)), _p(payload));
+      double elapsed = bench::seconds_since(start);
+
+      // the first few round trips warm up the server
+      if (sample >= 5u)
+      { round_trip_us.push_back(elapsed*1.0e6); }
+    }
+
+    bench::percentiles latency = bench::summarize(round_trip_us);
+    bench::result("latency")
+      .add("size_bytes", n_bytes)
+      .add("samples", n_samples)
+      .add("p50_us", latency.p50)
+      .add("p99_us", latency.p99)
+      .add("mean_us", latency.mean);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+#include "../include/cppyplot.hpp"
+#include "bench_util.h"
+
+/*
+  Packing phase of data_args with many copy-requiring containers in one call, 2D vectors and strided
+  Eigen blocks, for 1 thread up to every hardware thread of the packing pool, no transport involved.
+*/
+
+template<typename Cont_t>
+void bench_packing(const std::string& containers, std::size_t n_threads, std::size_t n_bytes, const std::vector<Cont_t>& conts)
+{
+  Cppyplot::cppyplot::set_packing_threads(n_threads);
+  // enough iterations for ~0.5s per case, at least 5
+  const std::size_t n_iters = std::max<std::size_t>(5u, (std::size_t{1u} << 31u)/std::max<std::size_t>(n_bytes, 64u));
+
+  double elapsed = 0.0;
+  for (std::size_t i = 0u; i < n_iters; i++)
+  {
+    auto start = bench::clock_type::now();
+    Cppyplot::packed_payloads packed;
+    for (const auto& cont : conts)
+    { packed.add(cont); }
+    packed.pack();
+    elapsed += bench::seconds_since(start);
+    bench::do_not_optimize(packed);
+  }
+
+  bench::result("packing")
+    .add("containers", containers)
+    .add("threads", n_threads)
+    .add("size_bytes", n_bytes)
+    .add("iterations", n_iters)
+    .add("ms_per_plot", elapsed*1.0e3/static_cast<double>(n_iters))
+    .add("gb_per_sec", static_cast<double>(n_bytes*n_iters)/elapsed*1.0e-9);
+}
+
+#ifdef EIGEN_AVAILABLE
+// whether the payload of cont, read in the memory order sent with it as the server does, holds expected
+template<typename Derived>
+bool arrives_as(const Eigen::MatrixXd& expected, const Eigen::EigenBase<Derived>& cont)
+{
+  zmq::message_t payload;
+  Cppyplot::fill_zmq_buffer(cont, payload);
+  const bool column_major = (Cppyplot::payload_order(cont.derived()) == 'F');
+  const double* data = static_cast<const double*>(payload.data());
+  for (Eigen::Index r = 0; r < expected.rows(); r++)
+  {
+    for (Eigen::Index c = 0; c < expected.cols(); c++)
+    {
+      if (data[column_major ? (c*expected.rows() + r) : (r*expected.cols() + c)] != expected(r, c))
+      { return false; }
+    }
+  }
+  return true;
+}
+
+// matrices and blocks of them plot identically whatever their storage order and strides
+bool check_eigen_layouts()
+{
+  Eigen::MatrixXd mat(6, 8);
+  for (Eigen::Index r = 0; r < mat.rows(); r++)
+  {
+    for (Eigen::Index c = 0; c < mat.cols(); c++)
+    { mat(r, c) = static_cast<double>(r*100 + c); }
+  }
+  const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> mat_rm = mat;
+
+  const bool same =    arrives_as(mat, mat) && arrives_as(mat, mat.block(0, 0, mat.rows(), mat.cols()))
+                    && arrives_as(mat.middleCols(2, 3), mat.middleCols(2, 3)) && arrives_as(mat.block(1, 2, 4, 5), mat.block(1, 2, 4, 5))
+                    && arrives_as(mat, mat_rm) && arrives_as(mat.block(1, 2, 4, 5), mat_rm.block(1, 2, 4, 5));
+  if (same == false)
+  { std::cerr << "Eigen matrices and their blocks arrive with different layouts\n"; }
+  return same;
+}
+#endif
+
+int main()
+{
+#ifdef EIGEN_AVAILABLE
+  if (check_eigen_layouts() == false)
+  { return EXIT_FAILURE; }
+#endif
+
+  const std::size_t n_containers = 12u;
+  // 12 containers of 16 MB each, scaled down with CPPYPLOT_BENCH_MAX_BYTES
+  const std::size_t cont_bytes = std::min<std::size_t>(bench::max_bytes()/n_containers, std::size_t{1u} << 24u);
+  const std::size_t n_cols = 2048u;
+  const std::size_t n_rows = std::max<std::size_t>(1u, cont_bytes/(sizeof(double)*n_cols));
+
+  std::vector<std::size_t> thread_counts;
+  const std::size_t hw_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1u);
+  for (std::size_t n_threads = 1u; n_threads < hw_threads; n_threads *= 2u)
+  { thread_counts.push_back(n_threads); }
+  thread_counts.push_back(hw_threads);
+
+  std::vector<std::vector<std::vector<double>>> vecs_2d(n_containers, std::vector<std::vector<double>>(n_rows, std::vector<double>(n_cols, 1.0)));
+  for (std::size_t n_threads : thread_counts)
+  { bench_packing("12 x std::vector<std::vector<double>>", n_threads, n_containers*n_rows*n_cols*sizeof(double), vecs_2d); }
+
+#ifdef EIGEN_AVAILABLE
+  // left half of row-major matrices, rows are strided
+  using row_major_t = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  std::vector<row_major_t> mats(n_containers, row_major_t::Ones(static_cast<Eigen::Index>(n_rows), static_cast<Eigen::Index>(2u*n_cols)));
+  std::vector<Eigen::Block<const row_major_t>> blocks;
+  for (const auto& mat : mats)
+  { blocks.push_back(mat.leftCols(static_cast<Eigen::Index>(n_cols))); }
+  for (std::size_t n_threads : thread_counts)
+  { bench_packing("12 x Eigen::Block<RowMajor>", n_threads, n_containers*n_rows*n_cols*sizeof(double), blocks); }
+#endif
+
+  return EXIT_SUCCESS;
+}
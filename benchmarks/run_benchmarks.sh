@@ -0,0 +1,18 @@
+#!/bin/bash
+# Runs every benchmark against a headless server and collects the results as JSON lines.
+# usage: run_benchmarks.sh <directory with the benchmark executables> [results file]
+#   CPPYPLOT_PYTHON            python used for the server (default python3)
+#   CPPYPLOT_BENCH_MAX_BYTES   largest payload in bytes (default 1 GB)
+set -e
+bin_dir=${1:-.}
+export CPPYPLOT_BENCH_RESULTS=${2:-benchmark_results.jsonl}
+export MPLBACKEND=Agg
+
+: > "$CPPYPLOT_BENCH_RESULTS"
+for bench in bench_serialization bench_transport bench_latency bench_startup bench_binning bench_packing; do
+  echo "running $bench"
+  "$bin_dir/$bench"
+done
+echo "running bench_transport with copying receives on the server"
+CPPYPLOT_RECV_COPY=1 "$bin_dir/bench_transport"
+echo "results written to $CPPYPLOT_BENCH_RESULTS"
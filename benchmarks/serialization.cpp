@@ -0,0 +1,70 @@
+#include "../include/cppyplot.hpp"
+#include "bench_util.h"
+
+#include <cmath>
+
+/*
+  Cost of turning a container into the header and payload parts of a plot,
+  create_header + fill_zmq_buffer for every supported container type, no transport involved.
+*/
+
+template<typename T>
+void bench_container(const std::string& container, const T& cont, std::size_t n_bytes)
+{
+  // enough iterations for ~0.2s per case, at least 10
+  std::size_t n_iters = std::max<std::size_t>(10u, (std::size_t{1u} << 28u)/std::max<std::size_t>(n_bytes, 64u));
+
+  auto start = bench::clock_type::now();
+  for (std::size_t i = 0u; i < n_iters; i++)
+  {
+    std::string header = Cppyplot::cppyplot::create_header("data", cont);
+    zmq::message_t payload;
+    Cppyplot::fill_zmq_buffer(cont, payload);
+    bench::do_not_optimize(header);
+    bench::do_not_optimize(payload);
+  }
+  double elapsed = bench::seconds_since(start);
+
+  bench::result("serialization")
+    .add("container", container)
+    .add("size_bytes", n_bytes)
+    .add("iterations", n_iters)
+    .add("ns_per_op", elapsed*1.0e9/static_cast<double>(n_iters))
+    .add("gb_per_sec", static_cast<double>(n_bytes*n_iters)/elapsed*1.0e-9);
+}
+
+int main()
+{
+  const std::size_t max_bytes = std::min<std::size_t>(bench::max_bytes(), std::size_t{1u} << 26u);
+  for (std::size_t n_bytes = 8u; n_bytes <= max_bytes; n_bytes *= 64u)
+  {
+    const std::size_t n_elems = n_bytes/sizeof(double);
+    const std::size_t n_rows  = std::max<std::size_t>(1u, static_cast<std::size_t>(std::sqrt(static_cast<double>(n_elems))));
+    const std::size_t n_cols  = std::max<std::size_t>(1u, n_elems/n_rows);
+
+    std::vector<double> vec(n_elems, 1.0);
+    bench_container("std::vector<double>", vec, n_bytes);
+
+    std::vector<std::vector<double>> vec_2d(n_rows, std::vector<double>(n_cols, 1.0));
+    bench_container("std::vector<std::vector<double>>", vec_2d, n_rows*n_cols*sizeof(double));
+
+    std::string str(n_bytes, 'a');
+    bench_container("std::string", str, n_bytes);
+
+#ifdef EIGEN_AVAILABLE
+    Eigen::MatrixXd mat = Eigen::MatrixXd::Ones(static_cast<Eigen::Index>(n_rows), static_cast<Eigen::Index>(n_cols));
+    bench_container("Eigen::MatrixXd", mat, n_rows*n_cols*sizeof(double));
+#endif
+  }
+
+  double scalar = 1.0;
+  bench_container("double", scalar, sizeof(double));
+
+  std::array<double, 64> arr{};
+  bench_container("std::array<double, 64>", arr, sizeof(arr));
+
+  std::array<std::array<double, 64>, 64> arr_2d{};
+  bench_container("std::array<std::array<double, 64>, 64>", arr_2d, sizeof(arr_2d));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,36 @@
+#include "../include/cppyplot.hpp"
+#include "bench_util.h"
+
+/*
+  Time until a freshly constructed plot object is usable: the constructor only registers the
+  session, the python server is spawned by the first plot and the first round trip includes
+  waiting for it to subscribe. Every run starts a new session on its own port.
+*/
+
+int main()
+{
+  constexpr unsigned int n_runs = 3u;
+  Cppyplot::cppyplot::set_python_path(bench::python_path());
+  Cppyplot::cppyplot::set_headless(true);
+  Cppyplot::cppyplot::set_stats_interval(0s);
+
+  for (unsigned int run = 0u; run < n_runs; run++)
+  {
+    const std::string name = "startup_"s + std::to_string(run);
+    auto start = bench::clock_type::now();
+    Cppyplot::cppyplot::add_session(name, "tcp://127.0.0.1:"s + std::to_string(5600u + run));
+    Cppyplot::cppyplot pyp(name);
+    double constructor_s = bench::seconds_since(start);
+
+    int ack = 0;
+    pyp.raw_recv(R"pyp(ack = 1)pyp", Cppyplot::outputs(_p(ack)));
+    double ready_s = bench::seconds_since(start);
+
+    bench::result("startup")
+      .add("run", run)
+      .add("constructor_ms", constructor_s*1.0e3)
+      .add("first_reply_ms", ready_s*1.0e3);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+#include "../include/cppyplot.hpp"
+#include "bench_util.h"
+
+/*
+  Messages/s and GB/s from data_args to the server dispatching the plot, for payloads from 8 bytes to 1 GB.
+  The server runs headless and the plots carry no commands, so rendering is stubbed out.
+  Frames are sent in windows closed by a raw_recv barrier: the server dispatches in order,
+  so the reply arrives once every frame before it was handled and the publisher never drops frames.
+  With CPPYPLOT_RECV_COPY=1 the server copies every received frame instead of keeping numpy arrays
+  as views over the zmq frames, to compare both receive paths.
+*/
+
+int main()
+{
+  Cppyplot::cppyplot::set_python_path(bench::python_path());
+  Cppyplot::cppyplot::set_headless(true);
+  Cppyplot::cppyplot::set_stats_interval(0s);
+  Cppyplot::cppyplot pyp;
+  const char* recv_copy = std::getenv("CPPYPLOT_RECV_COPY");
+  const std::string server_recv = ((recv_copy != nullptr) && (std::string{recv_copy} == "1")) ? "copy" : "zero_copy";
+
+  auto barrier = [&pyp]()
+  {
+    int ack = 0;
+    pyp.raw_recv(R"pyp(ack = 1)pyp", Cppyplot::outputs(_p(ack)));
+  };
+  barrier();
+
+  for (std::size_t n_bytes : bench::payload_sizes())
+  {
+    std::vector<double> payload(n_bytes/sizeof(double), 1.0);
+    const std::size_t n_frames = std::clamp<std::size_t>((std::size_t{1u} << 31u)/n_bytes, 4u, 20000u);
+    const std::size_t window   = std::clamp<std::size_t>((std::size_t{1u} << 26u)/n_bytes, 1u, 64u);
+
+    auto start = bench::clock_type::now();
+    for (std::size_t frame = 1u; frame <= n_frames; frame++)
+    {
+      pyp.data_args(_p(payload));
+      if ((frame % window) == 0u)
+      { barrier(); }
+    }
+    barrier();
+    double elapsed = bench::seconds_since(start);
+
+    bench::result("transport")
+      .add("server_recv", server_recv)
+      .add("size_bytes", n_bytes)
+      .add("frames", n_frames)
+      .add("window", window)
+      .add("msgs_per_sec", static_cast<double>(n_frames)/elapsed)
+      .add("gb_per_sec", static_cast<double>(n_frames*n_bytes)/elapsed*1.0e-9);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -43,6 +43,19 @@ int main()
   show(layout)
   )pyp", _p(rand_vecx), _p(rand_vecy));
 
+  /*
+    Both columns as one table, the server receives them as a pandas DataFrame (needs pyarrow)
+  */
+  Cppyplot::record_batch points(_p(rand_vecx), _p(rand_vecy));
+  pyp.raw(R"pyp(
+
+  source = ColumnDataSource(data=points)
+  plot = figure(plot_width=800, plot_height=800, x_axis_label='x', y_axis_label='y')
+  plot.scatter('rand_vecx', 'rand_vecy', source=source, fill_color="orange", alpha=0.6)
+  layout = row(plot)
+  show(layout)
+  )pyp", _p(points));
+
   return EXIT_SUCCESS;
   
 }
\ No newline at end of file
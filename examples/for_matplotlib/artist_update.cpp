@@ -0,0 +1,37 @@
+#include "../../include/cppyplot.hpp"
+#include <cmath>
+#include <random>
+
+int main()
+{
+  std::random_device seed;
+  std::mt19937 gen(seed());
+  std::normal_distribution<float> noise(0.0F, 0.1F);
+
+  std::vector<float> x(1000), y(1000, 0.0F);
+  std::iota(x.begin(), x.end(), 0.0F);
+
+  Cppyplot::cppyplot pyp;
+
+  // the figure is drawn once, every frame after that only redraws 'line'
+  pyp.raw(R"pyp(
+    plt.ion()
+    fig = plt.figure(figsize=(6,5))
+    ax = plt.axes(xlim=(0, 1000), ylim=(-1.5, 1.5))
+    line, = ax.plot(x, y, 'r-', linewidth=0.8)
+    plt.grid(True)
+    plt.xlabel("Sample", fontsize=12)
+    plt.title("Noisy sine", fontsize=14)
+    plt.show()
+  )pyp", _p(x), _p(y));
+
+  for (std::size_t frame = 0u; frame < 2000u; frame++)
+  {
+    for (std::size_t i = 0u; i < y.size(); i++)
+    { y[i] = std::sin(0.01F*static_cast<float>(i + frame)) + noise(gen); }
+
+    pyp.update_artist("line", _p(y));
+    std::this_thread::sleep_for(5ms);
+  }
+  return EXIT_SUCCESS;
+}
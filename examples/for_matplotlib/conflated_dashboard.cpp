@@ -0,0 +1,45 @@
+#include "../../include/cppyplot.hpp"
+#include <cmath>
+#include <random>
+
+int main()
+{
+  std::random_device seed;
+  std::mt19937 gen(seed());
+  std::normal_distribution<double> noise(0.0, 0.05);
+
+  std::vector<double> spectrum(64, 0.0);
+  double speed = 0.0;
+
+  Cppyplot::cppyplot pyp;
+  pyp.raw(R"pyp(
+    plt.ion()
+    fig, (ax_speed, ax_spec) = plt.subplots(1, 2, figsize=(10, 4))
+    ax_speed.axis("off")
+    gauge = ax_speed.text(0.5, 0.5, "", fontsize=32, ha="center", va="center")
+    bars, = ax_spec.plot(spectrum, "b-")
+    ax_spec.set_ylim(-0.2, 1.2)
+    ax_spec.set_title("spectrum", fontsize=14)
+    plt.show()
+  )pyp", _p(spectrum));
+
+  // the loop below updates ~100k times per second, the server plots 20 times per second
+  Cppyplot::conflator dash(pyp, R"pyp(
+    gauge.set_text(f"{speed:.1f} km/h")
+    bars.set_ydata(spectrum)
+    fig.canvas.draw_idle()
+    plt.pause(0.001)
+  )pyp", 50ms);
+
+  const auto t_end = std::chrono::steady_clock::now() + 20s;
+  for (std::size_t tick = 0u; std::chrono::steady_clock::now() < t_end; tick++)
+  {
+    speed = 80.0 + 20.0*std::sin(1e-5*static_cast<double>(tick));
+    for (std::size_t bin = 0u; bin < spectrum.size(); bin++)
+    { spectrum[bin] = std::exp(-std::pow((static_cast<double>(bin) - speed*0.4)/6.0, 2.0)) + noise(gen); }
+    dash.update(_p(speed), _p(spectrum));
+  }
+
+  std::cout << "sent " << dash.sent() << " plots, dropped " << dash.dropped() << " updates\n";
+  return EXIT_SUCCESS;
+}
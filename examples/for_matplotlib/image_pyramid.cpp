@@ -0,0 +1,38 @@
+#include "../../include/cppyplot.hpp"
+
+#include <cmath>
+#include <iostream>
+
+int main()
+{
+  // 12000 x 16000 interference pattern, ~770 MB as float
+  const std::size_t rows = 12000u, cols = 16000u;
+  std::vector<float> image(rows*cols);
+  for (std::size_t r = 0u; r < rows; r++)
+  {
+    for (std::size_t c = 0u; c < cols; c++)
+    {
+      const float y = static_cast<float>(r) - 0.5F*static_cast<float>(rows);
+      const float x = static_cast<float>(c) - 0.3F*static_cast<float>(cols);
+      image[r*cols + c] = std::sin(std::sqrt(x*x + y*y)*0.05F) + std::cos(static_cast<float>(c)*0.002F);
+    }
+  }
+
+  Cppyplot::image_pyramid<float> pyramid(image.data(), rows, cols, 512u);
+  std::cout << "built " << pyramid.n_levels() << " levels, sending "
+            << pyramid.rows(pyramid.n_levels() - 1u) << "x" << pyramid.cols(pyramid.n_levels() - 1u) << " pixels\n";
+
+  Cppyplot::cppyplot pyp;
+  pyp.raw(R"pyp(
+  fig, ax = plt.subplots(figsize=(10, 7))
+  pyramid.imshow(ax, cmap="twilight")
+  ax.set_title("zoom in, the tiles are pulled from c++", fontsize=14)
+  plt.show()
+  )pyp", _p(pyramid));
+
+  // the tiles are served from this process
+  std::cout << "Press enter to exit ...";
+  std::cin.get();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#include "../../include/cppyplot.hpp"
+
+#include <vector>
+#include <thread>
+#include <cmath>
+
+/*
+  Several worker threads share one plot object and submit plots concurrently.
+  Configure with -DCPPYPLOT_SANITIZE=thread (GCC/Clang) to check the submission path for data races,
+  libzmq needs to be built with ThreadSanitizer as well to avoid false positives from its internals.
+*/
+
+int main()
+{
+  constexpr unsigned int n_workers = 8u;
+  constexpr unsigned int n_plots_per_worker = 250u;
+
+  Cppyplot::cppyplot pyp;
+
+  pyp.raw_nowait(R"pyp(
+  received = {}
+  )pyp");
+
+  std::vector<std::thread> workers;
+  for (unsigned int worker = 0u; worker < n_workers; worker++)
+  {
+    workers.emplace_back([&pyp, worker]()
+    {
+      std::vector<float> samples(64);
+      for (unsigned int iter = 0u; iter < n_plots_per_worker; iter++)
+      {
+        for (std::size_t i = 0u; i < samples.size(); i++)
+        { samples[i] = std::sin(0.1F*static_cast<float>(i + iter + worker)); }
+
+        pyp.raw(R"pyp(
+        received[worker] = received.get(worker, 0) + 1
+        )pyp", _p(worker), _p(samples));
+      }
+    });
+  }
+
+  for (auto& thread : workers)
+  { thread.join(); }
+
+  int expected = n_plots_per_worker;
+  pyp.raw(R"pyp(
+  workers = sorted(received.keys())
+  plt.figure(figsize=(6,5))
+  plt.bar(workers, [received[w] for w in workers])
+  plt.axhline(expected, color='r', linestyle='--')
+  plt.xlabel("Worker thread", fontsize=12)
+  plt.ylabel("Plots received", fontsize=12)
+  plt.title("Concurrent submissions", fontsize=14)
+  plt.show()
+  )pyp", _p(expected));
+
+  return EXIT_SUCCESS;
+}
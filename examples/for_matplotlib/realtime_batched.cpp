@@ -0,0 +1,36 @@
+#include "../../include/cppyplot.hpp"
+#include <random>
+
+int main()
+{
+  std::random_device seed;
+  std::mt19937 gen(seed());
+  std::normal_distribution<float> norm(0.0, 0.5F);
+
+  Cppyplot::cppyplot pyp;
+
+  pyp.raw(R"pyp(
+    plt.ion()
+
+    fig = plt.figure(figsize=(6,5))
+    plt.axis([0, 100000, -1.5,1.5])
+    plt.grid(True)
+    plt.xlabel("Index", fontsize=12)
+    plt.ylabel("Data", fontsize=12)
+  )pyp");
+
+  // i and data are arrays of up to 2000 samples when the commands run
+  Cppyplot::point_batch stream(pyp, R"pyp(
+    plt.scatter(i, data, s=2, c='b', linewidths=1, alpha=0.4)
+    plt.show()
+    plt.pause(0.01)
+  )pyp", Cppyplot::flush_policy{2000u, 100ms});
+
+  for (std::size_t i = 0u; i < 100000u; i++)
+  {
+    auto data = norm(gen);
+    stream.push(_p(data), _p(i));
+    std::this_thread::sleep_for(10us);
+  }
+  return EXIT_SUCCESS;
+}
@@ -4,7 +4,10 @@
 
 int main()
 {
+  // frames of the exported gif are rendered on 4 worker processes while the server keeps plotting
+  Cppyplot::cppyplot::set_export_workers(4u);
   Cppyplot::cppyplot pyp;
+  Cppyplot::animation_export job;
 
   std::vector<float> vec(500, 0.0F);
   std::vector<float> sine, cosine;
@@ -17,10 +20,10 @@ int main()
   std::uniform_real_distribution<float> uniform(0.0F, 1.0F);
 
   std::transform(vec.begin(), vec.end(), std::back_inserter(sine), 
-                [&](auto& elem){return uniform(gen)*std::sinf(elem * 3.14159265F/180.0F);});
+                [&](auto& elem){return uniform(gen)*std::sin(elem * 3.14159265F/180.0F);});
 
   std::transform(vec.begin(), vec.end(), std::back_inserter(cosine), 
-                [&](auto& elem){return uniform(gen)*std::cosf(elem * 3.14159265F/180.0F);});
+                [&](auto& elem){return uniform(gen)*std::cos(elem * 3.14159265F/180.0F);});
 
   pyp.raw(R"pyp(
     
@@ -48,8 +51,15 @@ int main()
 
   anim = FuncAnimation(fig, anim_update, init_func=anim_init, 
                        frames=500, interval=2, blit=True)
-  anim.save("misc/sin.gif")
+  job.save(anim, "misc/sin.gif")
   plt.show()
-  )pyp", _p(vec), _p(sine), _p(cosine));
+  )pyp", _p(vec), _p(sine), _p(cosine), _p(job));
 
+  const auto state = job.wait_for(std::chrono::minutes(2));
+  if (state == Cppyplot::animation_export::status::done)
+  { std::cout << "wrote " << job.frames() << " frames to " << job.path() << " in " << job.seconds() << " s\n"; }
+  else if (state == Cppyplot::animation_export::status::failed)
+  { std::cout << "export failed: " << job.error() << '\n'; }
+  else
+  { std::cout << "export did not finish within 2 minutes\n"; }
 }
\ No newline at end of file
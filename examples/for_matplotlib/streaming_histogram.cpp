@@ -0,0 +1,44 @@
+#include "../../include/cppyplot.hpp"
+#include <random>
+
+int main()
+{
+  std::random_device seed;
+  std::mt19937 gen(seed());
+  std::normal_distribution<double> norm(0.0, 2.0);
+
+  Cppyplot::histogram   hist(100u, -8.0, 8.0);
+  Cppyplot::histogram2d heat(200u, -8.0, 8.0, 150u, -6.0, 6.0);
+  auto edges  = hist.edges();
+  auto extent = heat.extent();
+
+  Cppyplot::cppyplot pyp;
+
+  // 100M samples in chunks of 1M, only the bin counts are sent after every chunk
+  pyp.raw(R"pyp(
+    plt.ion()
+    fig, (ax1, ax2) = plt.subplots(1, 2, figsize=(12, 5))
+    steps = ax1.stairs(hist, edges, fill=True)
+    ax1.set_ylim(0, 5.0e6)
+    ax1.set_title("x", fontsize=14)
+    img = ax2.imshow(heat, extent=extent, origin='lower', aspect='auto', vmin=0, vmax=1.0e5)
+    ax2.set_title("x vs 0.5x + noise", fontsize=14)
+    plt.show()
+  )pyp", _p(hist), _p(edges), _p(heat), _p(extent));
+
+  std::vector<double> x(1000000u), y(1000000u);
+  for (std::size_t chunk = 0u; chunk < 100u; chunk++)
+  {
+    for (std::size_t i = 0u; i < x.size(); i++)
+    {
+      x[i] = norm(gen);
+      y[i] = 0.5*x[i] + norm(gen);
+    }
+    hist.add(x);
+    heat.add(x, y);
+
+    pyp.update_artist("steps", _p(hist));
+    pyp.update_artist("img", _p(heat));
+  }
+  return EXIT_SUCCESS;
+}
@@ -10,8 +10,8 @@ int main()
   std::generate(angles_rad.begin(), angles_rad.end(),   [&n, step]() mutable{ return (n += step);});
   
   std::vector<float> sin_angle(100), cos_angle(100);
-  std::transform(angles_rad.begin(), angles_rad.end(), sin_angle.begin(), [](auto& elem){return std::sinf(elem);});
-  std::transform(angles_rad.begin(), angles_rad.end(), cos_angle.begin(), [](auto& elem){return std::cosf(elem);});
+  std::transform(angles_rad.begin(), angles_rad.end(), sin_angle.begin(), [](auto& elem){return std::sin(elem);});
+  std::transform(angles_rad.begin(), angles_rad.end(), cos_angle.begin(), [](auto& elem){return std::cos(elem);});
 
   Cppyplot::cppyplot pyp;
 
@@ -0,0 +1,39 @@
+#include "../../include/cppyplot.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+int main()
+{
+  // 100 million samples of a noisy chirp with a few glitches, ~400 MB as float
+  const std::size_t n = 100000000u;
+  const double dt = 1e-5;
+  std::mt19937 gen(42);
+  std::normal_distribution<float> noise(0.0F, 0.05F);
+  std::vector<float> signal(n);
+  for (std::size_t i = 0u; i < n; i++)
+  {
+    const double t = static_cast<double>(i)*dt;
+    signal[i] = static_cast<float>(std::sin(6.283185307179586*(0.5 + 0.2*t)*t)) + noise(gen);
+  }
+  for (std::size_t i = 1234567u; i < n; i += 31415926u)
+  { signal[i] = 3.0F; }
+
+  Cppyplot::zoom_series<float> trace(signal.data(), n, 0.0, dt);
+
+  Cppyplot::cppyplot pyp;
+  pyp.raw(R"pyp(
+  fig, ax = plt.subplots(figsize=(12, 4))
+  trace.plot(ax, lw=0.5, color="k")
+  ax.set_xlabel("time [s]")
+  ax.set_title("zoom in, the visible range is pulled from c++", fontsize=14)
+  plt.show()
+  )pyp", _p(trace));
+
+  // the samples are served from this process
+  std::cout << "Press enter to exit ...";
+  std::cin.get();
+
+  return EXIT_SUCCESS;
+}
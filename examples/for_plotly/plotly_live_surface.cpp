@@ -0,0 +1,47 @@
+#include "../../include/cppyplot.hpp"
+#include <cmath>
+#include <random>
+
+int main()
+{
+  std::random_device seed;
+  std::mt19937 gen(seed());
+  std::normal_distribution<float> noise(0.0F, 0.05F);
+
+  constexpr std::size_t n = 200u;
+  std::vector<float> grid(n);
+  for (std::size_t i = 0u; i < n; i++)
+  { grid[i] = -3.0F + 6.0F*static_cast<float>(i)/static_cast<float>(n - 1u); }
+  std::vector<float> z(n*n, 0.0F);
+
+  Cppyplot::cppyplot pyp;
+
+  // the figure is sent to the browser once, open http://127.0.0.1:8050
+  pyp.raw(R"pyp(
+    fig = make_subplots(rows=1, cols=2, specs=[[{'type': 'surface'}, {'type': 'xy'}]])
+    fig.add_trace(go.Surface(x=grid, y=grid, z=z.reshape((grid.shape[0], grid.shape[0])), colorscale='Viridis', showscale=False), row=1, col=1)
+    fig.add_trace(go.Scatter(x=[], y=[], mode='lines'), row=1, col=2)
+    fig.update_layout(title_text='Live surface', height=700)
+    live = live_figure(fig, port=8050)
+  )pyp", _p(grid), _p(z));
+
+  // every frame after that only pushes the new surface and the new point as typed arrays
+  for (std::size_t frame = 0u; frame < 5000u; frame++)
+  {
+    const float phase = 0.02F*static_cast<float>(frame);
+    for (std::size_t i = 0u; i < n; i++)
+    {
+      for (std::size_t j = 0u; j < n; j++)
+      { z[i*n + j] = std::sin(grid[i] + phase)*std::cos(grid[j] - phase) + noise(gen); }
+    }
+    const float t = static_cast<float>(frame);
+    const float peak = z[(n/2u)*n + n/2u];
+
+    pyp.raw(R"pyp(
+      live.restyle(0, z=z.reshape((n, n)))
+      live.extend(1, x=t, y=peak, max_points=1000)
+    )pyp", _p(z), _p(n), _p(t), _p(peak));
+    std::this_thread::sleep_for(20ms);
+  }
+  return EXIT_SUCCESS;
+}
@@ -28,7 +28,7 @@ int main()
 #ifdef EIGEN_AVAILABLE
   // fill eigen matrix
   Eigen::Matrix<double, 5000, 2> mat;
-  for (auto& row: mat.rowwise())
+  for (auto row: mat.rowwise())
   {
     for (auto& elem : row)
     { elem = norm(gen); }
@@ -8,10 +8,25 @@
 */
 
 #include <string>
+#include <array>
+#include <sstream>
 #include <vector>
 #include <map>
 #include <iostream>
 #include <numeric>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdexcept>
+#include <tuple>
+#include <cstdint>
+#include <string_view>
+#include <algorithm>
+#include <functional>
+#include <system_error>
+#include <iomanip>
+#include <limits>
 
 #include <zmq.hpp>
 #include <zmq_addon.hpp>
@@ -22,19 +37,36 @@
 #include <utility>
 #include <filesystem>
 
-// Eigen
-#if __has_include(<Eigen/Core>)
-  #include <Eigen/Core>
-  #define EIGEN_AVAILABLE
-#elif __has_include (<Eigen/Eigen/Core>)
-  #include <Eigen/Eigen/Core>
-  #define EIGEN_AVAILABLE
-#endif
+#include "cppyplot_types.h"
+#include "cppyplot_container_support.h"
+#include "cppyplot_binning.h"
+#include "cppyplot_stats.h"
+#include "cppyplot_process.h"
+#include "cppyplot_providers.h"
+#include "cppyplot_pyramid.h"
+#include "cppyplot_zoom.h"
+#include "cppyplot_animation.h"
+#include "cppyplot_arrow.h"
+#include "cppyplot_packing.h"
+#include "cppyplot_schema.h"
 
 using namespace std::chrono_literals;
 using namespace std::string_literals;
 
-#define PYTHON_PATH "C:/Anaconda3/python.exe"
+// with CPPYPLOT_COMPILED_LIB the non-template parts are compiled once into the cppyplot_transport library,
+// otherwise they are defined inline in every translation unit including this header
+#ifdef CPPYPLOT_COMPILED_LIB
+  #define CPPYPLOT_INLINE
+#else
+  #define CPPYPLOT_INLINE inline
+#endif
+
+// posix_spawnp searches PATH for the default interpreter
+#if defined(_WIN32) || defined(_WIN64)
+  #define PYTHON_PATH "C:/Anaconda3/python.exe"
+#else
+  #define PYTHON_PATH "python3"
+#endif
 #define HOST_ADDR "tcp://127.0.0.1:5555"
 
 template <std::size_t ... indices>
@@ -58,77 +90,355 @@ namespace Cppyplot
 {
 
 // utility function for raw string literal parsing
-std::string dedent_string(const std::string_view raw_str);
+CPPYPLOT_INLINE std::string dedent_string(const std::string_view raw_str);
 
 template<typename T>
 std::string shape_str(const T& shape);
 
-#include "cppyplot_types.h"
-#include "cppyplot_container_support.h"
+struct server_options{
+  std::string  python_path{PYTHON_PATH};
+  bool         headless = false;
+  unsigned int n_render_workers = 0u;
+  unsigned int n_export_workers = 0u;                   // worker processes rendering animations exported with animation_export
+  std::chrono::milliseconds reply_timeout{60000};
+  std::chrono::seconds stats_interval{10};
+  bool         lazy_spawn = true;                       // spawn the server on the first plot instead of when the session is added
+  std::chrono::milliseconds startup_timeout{60000};     // until the spawned server subscribed
+  std::chrono::milliseconds heartbeat_timeout{10000};   // a server silent for longer is killed and restarted, zero disables it
+  unsigned int max_restarts = 3u;                       // in a row, a server running for a minute resets the count
+  std::chrono::milliseconds shutdown_timeout{5000};     // headless servers are terminated if they did not exit by then
+  std::function<void(std::string_view)> server_log;     // receives every line the server prints, stdout if empty
+  std::string  daemon_addr;                             // cppyplot_daemon.py handing out warm servers, CPPYPLOT_DAEMON if empty
+  std::chrono::milliseconds daemon_timeout{500};        // the daemon's answer is waited for, a server is spawned after
+  std::vector<std::string> libraries;                   // alias=module[:attribute] added to the server's library registry
+};
 
-class cppyplot{
+// header sent back by the server for every variable requested with raw_recv/data_recv
+struct reply_header{
+  std::uint64_t req_id = 0u;
+  std::string   key;
+  std::string   typestr;
+  std::vector<std::size_t> shape;
+  std::string   error_msg;
+};
+CPPYPLOT_INLINE reply_header parse_reply_header(const std::string_view header);
+
+// absolute path and size in bytes of a file sent as mapped_file, throws if it can not be read
+CPPYPLOT_INLINE std::pair<std::string, std::size_t> mapped_file_info(const std::string& path);
+
+// endpoint of a session's reply or service socket (named by role) on the transport and host of its address:
+// a port the OS picks for tcp://, the session's path with _<role> appended for ipc://. Other transports throw,
+// the server can not reach them from its process
+CPPYPLOT_INLINE std::string side_endpoint(const std::string& host_addr, std::string_view role);
+
+// tag used to route every finalized plot to the next registered session
+struct round_robin_t { explicit round_robin_t() = default; };
+inline constexpr round_robin_t round_robin{};
+
+/*
+  * One python server and the zmq publisher connected to it.
+  * ZMQ sockets are not thread-safe, so the publisher is owned by a forwarder thread.
+  * Every producer thread gets its own PUSH socket connected to the forwarder over inproc,
+  * a finalized plot is pushed as one multipart message and reaches the publisher without interleaving.
+  * The publisher is an XPUB, the forwarder sees the server subscribe and disconnect, plots are only
+  * submitted while it is subscribed. A supervisor thread forwards the server output, watches its
+  * heartbeats and restarts it when it crashed or hung. The forwarder also answers the data the server
+  * pulls from data_providers.
+*/
+class session{
   private:
-    static zmq::context_t context_;
-    static zmq::socket_t socket_;
-    static bool is_zmq_established_;
-    static std::string python_path_;
-    static std::string zmq_ip_addr_;
-    std::stringstream plot_cmds_;
+    static inline zmq::context_t context_{1};
+    static inline std::atomic<std::size_t> n_sessions_{0u};
+    std::size_t   id_;
+    zmq::socket_t socket_;   // XPUB, only used by the forwarder thread once started
+    zmq::socket_t fan_in_;   // PULL, collects plots from all producer threads
+    std::string   fan_in_addr_;
+    zmq::socket_t reply_;    // PULL, the server pushes requested variables back
+    std::string   reply_addr_;
+    zmq::socket_t service_;  // REP, answers data the server pulls from data_providers, served by the forwarder
+    std::string   service_addr_;
+    std::mutex    reply_mutex_;
+    std::uint64_t next_req_id_ = 1u;
+    std::thread   forwarder_;
+    std::atomic<bool> stop_forwarder_{false};
+    std::mutex    state_mutex_;
+    std::string   zmq_ip_addr_;
+    server_options options_;
+    bool          is_zmq_established_ = false;
+
+    // server process and its supervision
+    server_process process_;
+    std::thread   supervisor_;
+    std::atomic<bool> stop_supervisor_{false};
+    std::atomic<bool> shutting_down_{false};
+    std::atomic<bool> subscribed_{false};
+    std::atomic<bool> server_failed_{false};
+    std::atomic<std::uint64_t> restarts_{0u};
+    std::mutex    ready_mutex_;
+    std::condition_variable ready_cv_;
+
+    // frame schemas sent to the running server and when, forgotten when it is restarted
+    std::mutex    schemas_mutex_;
+    std::vector<std::pair<std::uint64_t, std::chrono::steady_clock::time_point>> sent_schemas_;
+    std::uint64_t schemas_restarts_ = 0u;
+
+    // instrumentation, updated lock-free from producer threads and the forwarder
+    std::atomic<std::uint64_t> next_frame_seq_{0u};
+    std::atomic<std::uint64_t> frames_sent_{0u};
+    std::atomic<std::uint64_t> frames_published_{0u};
+    std::atomic<std::uint64_t> bytes_sent_{0u};
+    std::atomic<std::uint64_t> stats_start_ns_{0u};
+    latency_histogram serialize_latency_;
+    latency_histogram publish_latency_;
+    latency_histogram round_trip_latency_;
+
+    // the last part of every plot is "finalize|<frame seq>|<submit time in ns>"
+    void record_published(const zmq::message_t& final_msg) noexcept;
+
+    void forward();
+
+    void set_subscribed(bool subscribed);
+
+    // arguments of cppyplot_server.py, without the heartbeat pipe
+    std::vector<std::string> server_args() const;
+
+    // ask the daemon at daemon_addr for a warm server, false if it can not provide one
+    bool request_warm_server(const std::string& daemon_addr);
+
+    // from the daemon if one is configured, spawned locally otherwise
+    void launch_server();
+
+    void log_server(std::string_view line) const;
+
+    void supervise();
+
   public:
-    cppyplot()
+    session(const std::string& zmq_ip_addr, const server_options& options);
+    session(session& other) = delete;
+    session operator=(session& other) = delete;
+    ~session() { stop(); }
+
+    // bind the publisher and spawn the python server, does not wait for it to come up
+    void start();
+
+    // start() if needed and block until the server subscribed, throws if it does not come up
+    void ensure_ready();
+
+    void stop();
+
+    // sequence number of the next plot, the server counts gaps as dropped frames
+    std::uint64_t next_frame_seq() noexcept
+    { return next_frame_seq_.fetch_add(1u, std::memory_order_relaxed); }
+
+    // a plot of n_bytes submitted at t_submit was pushed completely
+    void record_sent(frame_clock::time_point t_submit, std::size_t n_bytes) noexcept
+    {
+      serialize_latency_.record(elapsed_ns(t_submit));
+      frames_sent_.fetch_add(1u, std::memory_order_relaxed);
+      bytes_sent_.fetch_add(n_bytes, std::memory_order_relaxed);
+    }
+
+    void record_round_trip(frame_clock::time_point t_submit) noexcept
+    { round_trip_latency_.record(elapsed_ns(t_submit)); }
+
+    session_stats stats() const noexcept;
+
+    // restart the measurement window, frames in flight while resetting may be counted in either window
+    void reset_stats() noexcept;
+
+    // one request/reply round trip at a time per session, replies arrive in request order
+    [[nodiscard]] std::unique_lock<std::mutex> lock_replies()
+    { return std::unique_lock<std::mutex>(reply_mutex_); }
+
+    // only valid while holding lock_replies()
+    std::uint64_t next_request_id() noexcept
+    { return next_req_id_++; }
+
+    // receive variable 'key' of request 'req_id' directly into the container, only valid while holding lock_replies()
+    template<typename T>
+    void recv_reply(std::uint64_t req_id, const std::string& key, T& cont)
     {
-      if (cppyplot::is_zmq_established_ == false)
+      zmq::message_t msg;
+      reply_header header;
+      const std::uint64_t restarts_before = restarts_.load(std::memory_order_relaxed);
+      while (true)
       {
-        cppyplot::socket_.bind(cppyplot::zmq_ip_addr_);
-        std::this_thread::sleep_for(100ms);
-      
-        std::filesystem::path path(__FILE__);
-        std::string server_file_spawn;
+        wait_reply(restarts_before, key);
+        if (reply_.recv(msg, zmq::recv_flags::none).has_value() == false)
+        { throw std::runtime_error("cppyplot: timed out waiting for '"s + key + "' from the server"s); }
 
-#if defined(_WIN32) || defined(_WIN64)
-        server_file_spawn.append("start /min "s);
-#endif
-        server_file_spawn.append(cppyplot::python_path_);
-        server_file_spawn += " "s;
-        server_file_spawn += path.parent_path().string();
-        server_file_spawn += "/cppyplot_server.py "s;
-        server_file_spawn.append(cppyplot::zmq_ip_addr_);
-
-#if defined(__unix__)
-        server_file_spawn += " &"s;
-#endif
-        std::system(server_file_spawn.c_str());
-        std::this_thread::sleep_for(3.0s);
+        header = parse_reply_header(msg.to_string_view());
+        if (header.req_id == req_id)
+        { break; }
+
+        // left over from an earlier request that failed or timed out
+        discard_reply_payload();
+      }
 
-        cppyplot::is_zmq_established_ = true;
-        std::atexit(zmq_kill_command);
+      if (header.error_msg.empty() == false)
+      {
+        discard_reply_payload();
+        throw std::runtime_error("cppyplot: server could not send back '"s + key + "': "s + header.error_msg);
+      }
+      if ((header.key != key) || (header.typestr != std::string{unpack_type<T>().typestr}))
+      {
+        discard_reply_payload();
+        throw std::runtime_error("cppyplot: unexpected reply '"s + header.key + "' of type '"s + header.typestr + "' for '"s + key + "'"s);
+      }
+      try
+      { recv_zmq_buffer(reply_, cont, header.shape); }
+      catch (...)
+      {
+        // keep the reply stream aligned on headers for the next request
+        discard_reply_payload();
+        throw;
       }
     }
+
+    void discard_reply_payload();
+
+    // block until a reply is available, throws once reply_timeout passed or the server was restarted meanwhile
+    void wait_reply(std::uint64_t restarts_before, const std::string& key);
+
+    // socket private to the calling thread, everything sent on it is forwarded to the server
+    zmq::socket_t& producer_socket();
+
+    // true if the layout of a schema has to be sent ahead of its frame: the first time the running server
+    // sees it and again once a second, in case the plot carrying it was dropped by the publisher
+    bool schema_due(std::uint64_t schema_id);
+
+    const std::string& host_ip() const noexcept
+    { return zmq_ip_addr_; }
+};
+
+// variables to receive back from the server after the commands are executed
+template<typename... Out_t>
+struct recv_args{
+  std::tuple<std::pair<std::string, Out_t>...> args;
+};
+
+template<typename... Out_t>
+recv_args<Out_t...> outputs(std::pair<std::string, Out_t>&&... args)
+{ return recv_args<Out_t...>{ {std::forward<std::pair<std::string, Out_t>>(args)...} }; }
+
+class cppyplot{
+  private:
+    static inline std::string zmq_ip_addr_{HOST_ADDR};
+    static inline server_options options_{};
+    static inline std::map<std::string, std::unique_ptr<session>> sessions_{};
+    static inline std::vector<session*> session_order_{};
+    static inline std::atomic<std::size_t> next_session_{0u};
+    static inline std::mutex sessions_mutex_{};
+    static inline std::atomic<std::size_t> n_instances_{0u};
+    session* session_ = nullptr; // nullptr routes every plot round-robin
+    std::size_t id_ = cppyplot::n_instances_.fetch_add(1u);
+
+    // plotting commands are staged per thread, so one instance can be shared between threads.
+    // The buffers belong to the instance and are released with it
+    std::mutex staging_mutex_;
+    std::map<std::thread::id, std::stringstream> staging_;
+
+    std::stringstream& plot_cmds();
+
+    static session& start_session(const std::string& name, const std::string& host_ip);
+
+    // session of the next plot, the server is spawned on first use
+    session& route();
+
+  public:
+    // plots into the default session, spawned on first use
+    cppyplot();
+
+    // plots into a session registered with add_session
+    explicit cppyplot(const std::string& session_name);
+
+    explicit cppyplot(session& target);
+
+    // every finalized plot goes to the next registered session
+    explicit cppyplot(round_robin_t);
+
     cppyplot(cppyplot& other) = delete;
     cppyplot operator=(cppyplot& other) = delete;
-    ~cppyplot() {}
+    ~cppyplot();
 
     static void set_python_path(const std::string& python_path) noexcept
-    { cppyplot::python_path_ = python_path; }
+    { cppyplot::options_.python_path = python_path; }
 
     static void set_host_ip(const std::string& host_ip) noexcept
     { cppyplot::zmq_ip_addr_ = host_ip; }
 
-    static void zmq_kill_command()
-    {
-      if (cppyplot::is_zmq_established_ == true)
-      {
-        // if the python server is spawned through this class instance, then send exit command
-        zmq::message_t exit_msg("exit", 4);
-        cppyplot::socket_.send(exit_msg, zmq::send_flags::none);
-        
-        cppyplot::is_zmq_established_ = false;
-        cppyplot::socket_.disconnect(cppyplot::zmq_ip_addr_);
-      }
-    }
+    // render with the Agg backend, with n_workers > 0 every finalized plot is rendered
+    // as an independent job on a pool of worker processes
+    static void set_headless(bool headless, unsigned int n_workers = 0u) noexcept
+    { cppyplot::options_.headless = headless; cppyplot::options_.n_render_workers = n_workers; }
+
+    // worker processes the server starts to render the frames of animations exported with animation_export,
+    // with 0 job.save renders and encodes in place and holds up the plots until the file is written
+    static void set_export_workers(unsigned int n_workers) noexcept
+    { cppyplot::options_.n_export_workers = n_workers; }
+
+    // how long raw_recv/data_recv wait for the server before throwing
+    static void set_reply_timeout(std::chrono::milliseconds timeout) noexcept
+    { cppyplot::options_.reply_timeout = timeout; }
+
+    // threads packing the copy-requiring containers of one plot (nested vectors, strided Eigen blocks), 0 uses every hardware thread
+    static void set_packing_threads(std::size_t n_threads) noexcept
+    { packing_pool::set_threads(n_threads); }
+
+    // payloads larger than n_bytes (64 MB by default) are streamed to the server in chunks of n_bytes, 0 disables chunking
+    static void set_chunk_size(std::size_t n_bytes) noexcept
+    { packed_payloads::set_chunk_bytes(n_bytes); }
+
+    // interval of the [STATS] line printed by the server, zero disables it
+    static void set_stats_interval(std::chrono::seconds interval) noexcept
+    { cppyplot::options_.stats_interval = interval; }
+
+    // with lazy spawn (the default) a session starts its server on the first plot,
+    // otherwise add_session and the first plot object of the default session start it
+    static void set_lazy_spawn(bool lazy) noexcept
+    { cppyplot::options_.lazy_spawn = lazy; }
+
+    // how long the first plot waits for a spawned server before throwing
+    static void set_startup_timeout(std::chrono::milliseconds timeout) noexcept
+    { cppyplot::options_.startup_timeout = timeout; }
+
+    // servers that crash or miss heartbeats for heartbeat_timeout are restarted up to max_restarts times in a row
+    static void set_restart_policy(unsigned int max_restarts, std::chrono::milliseconds heartbeat_timeout = 10000ms) noexcept
+    { cppyplot::options_.max_restarts = max_restarts; cppyplot::options_.heartbeat_timeout = heartbeat_timeout; }
+
+    // how long headless servers get to exit at shutdown before they are terminated
+    static void set_shutdown_timeout(std::chrono::milliseconds timeout) noexcept
+    { cppyplot::options_.shutdown_timeout = timeout; }
+
+    // every line printed by the python servers is passed to sink instead of stdout, called from a supervisor thread
+    static void set_server_log(std::function<void(std::string_view)> sink)
+    { cppyplot::options_.server_log = std::move(sink); }
+
+    // take servers from a running cppyplot_daemon.py instead of spawning them, falls back to spawning
+    // if the daemon does not answer within timeout. The CPPYPLOT_DAEMON environment variable is used if this is not set
+    static void set_server_daemon(const std::string& daemon_addr, std::chrono::milliseconds timeout = 500ms)
+    { cppyplot::options_.daemon_addr = daemon_addr; cppyplot::options_.daemon_timeout = timeout; }
+
+    // make module (or module.attribute when given) available to plot commands as alias, e.g.
+    // add_library("sns", "seaborn") or add_library("figure", "bokeh.plotting", "figure").
+    // The server imports it the first time a plot uses alias
+    static void add_library(const std::string& alias, const std::string& module, const std::string& attribute = "")
+    { cppyplot::options_.libraries.push_back(alias + "="s + module + (attribute.empty() ? ""s : ":"s + attribute)); }
+
+    // client side latency and throughput of a session
+    static session_stats stats(const std::string& session_name = "default")
+    { return cppyplot::get_session(session_name).stats(); }
+
+    // register an additional python server listening on host_ip, options are taken from the current settings
+    static session& add_session(const std::string& name, const std::string& host_ip)
+    { return cppyplot::start_session(name, host_ip); }
+
+    static session& get_session(const std::string& name);
+
+    static void zmq_kill_command();
 
     inline void push(const std::string& cmds)
-    { plot_cmds_ << cmds << '\n'; }
+    { plot_cmds() << cmds << '\n'; }
 
     inline void operator<<(const std::string& cmds)
     { this->push(cmds); }
@@ -136,33 +446,44 @@ class cppyplot{
     template<unsigned int N>
     void raw(const char (&input_cmds)[N]) noexcept
     {
-      plot_cmds_ << dedent_string(input_cmds);
+      plot_cmds() << dedent_string(input_cmds);
     }
 
     template<unsigned int N, typename... Val_t>
     void raw(const char (&input_cmds)[N], std::pair<std::string, Val_t>&&... args)
     {
-      plot_cmds_ << dedent_string(input_cmds);
+      plot_cmds() << dedent_string(input_cmds);
       data_args(std::forward<std::pair<std::string, Val_t>>(args)...);
     }
 
     template<unsigned int N>
     void raw_nowait(const char (&input_cmds)[N])
     {
-      plot_cmds_ << dedent_string(input_cmds);
-      
-      zmq::message_t cmds(plot_cmds_.str());
-      cppyplot::socket_.send(cmds, zmq::send_flags::none);
+      plot_cmds() << dedent_string(input_cmds);
 
-      zmq::message_t final("finalize", 8);
-      cppyplot::socket_.send(final, zmq::send_flags::none);
+      const auto t_submit = frame_clock::now();
+      session& target = route();
+      zmq::socket_t& socket = target.producer_socket();
+
+      zmq::message_t cmds(plot_cmds().str());
+      std::size_t n_bytes = cmds.size();
+      socket.send(cmds, zmq::send_flags::sndmore);
+
+      send_finalize(target, socket, t_submit, n_bytes);
 
       /* reset */
-      plot_cmds_.str("");
+      plot_cmds().str("");
+    }
+
+    template<unsigned int N, typename... Out_t, typename... Val_t>
+    void raw_recv(const char (&input_cmds)[N], recv_args<Out_t...>&& outs, std::pair<std::string, Val_t>&&... args)
+    {
+      plot_cmds() << dedent_string(input_cmds);
+      data_recv(std::move(outs), std::forward<std::pair<std::string, Val_t>>(args)...);
     }
 
     template<typename T>
-    inline std::string create_header(const std::string& key, const T& cont) noexcept
+    static std::string create_header(const std::string& key, const T& cont) noexcept
     {
       auto elem_type = unpack_type<T>();
       std::string header{"data|"};
@@ -181,110 +502,322 @@ class cppyplot{
 
       // shape of the container 
       header += shape_str(container_shape(cont));
+      header.append("|");
+
+      // memory order of the payload ('C' or 'F')
+      header += payload_order(cont);
 
       return header;
     }
 
+    // returns the number of bytes sent
     template <typename T>
-    void send_container(const std::string& key, const T& cont)
+    std::size_t send_container(zmq::socket_t& socket, const std::string& key, const T& cont)
     { 
+      // chunked|<key>|<stream id>, the payload was streamed ahead of the plot
+      if (const auto [stream_id, stream_bytes] = packed_payloads::streamed(cont); stream_id != 0u)
+      {
+        zmq::message_t msg("chunked|"s + key + "|"s + std::to_string(stream_id));
+        const std::size_t n_bytes = msg.size() + stream_bytes;
+        socket.send(msg, zmq::send_flags::sndmore);
+        return n_bytes;
+      }
+
       std::string data_header{create_header(key, cont)};
       zmq::message_t msg(data_header.c_str(), data_header.length());
-      cppyplot::socket_.send(msg, zmq::send_flags::none);
+      socket.send(msg, zmq::send_flags::sndmore);
 
       zmq::message_t payload;
-      fill_zmq_buffer(cont, payload);
-      cppyplot::socket_.send(payload, zmq::send_flags::none);
+      if (packed_payloads::take(cont, payload) == false)
+      { fill_zmq_buffer(cont, payload); }
+      std::size_t n_bytes = data_header.length() + payload.size();
+      socket.send(payload, zmq::send_flags::sndmore);
+      return n_bytes;
+    }
+
+    // mmap|<key>|<type>|<shape>|<offset>|<order> followed by the absolute path, the server maps the file itself
+    template <typename T>
+    std::size_t send_container(zmq::socket_t& socket, const std::string& key, const mapped_file<T>& file)
+    {
+      const auto [path, file_bytes] = mapped_file_info(file.path);
+      const std::size_t available = (file_bytes > file.offset) ? (file_bytes - file.offset)/sizeof(T) : 0u;
+      std::vector<std::size_t> shape{file.shape};
+      if (shape.empty() == true)
+      { shape.push_back(available); }
+      if (shape_size(shape) > available)
+      {
+        throw std::length_error("cppyplot: '"s + path + "' holds "s + std::to_string(available)
+                                + " elements after the offset, the shape needs "s + std::to_string(shape_size(shape)));
+      }
+
+      std::string header{"mmap|"};
+      header += key;
+      header.append("|");
+      header += std::string{unpack_type<T>().typestr};
+      header.append("|");
+      header += shape_str(shape);
+      header.append("|");
+      header += std::to_string(file.offset);
+      header.append("|");
+      header += file.order;
+
+      zmq::message_t msg(header.c_str(), header.length());
+      socket.send(msg, zmq::send_flags::sndmore);
+      zmq::message_t path_msg(path.c_str(), path.length());
+      socket.send(path_msg, zmq::send_flags::sndmore);
+      return header.length() + path.length();
+    }
+
+    // pyramid|<key>|<type>|<shape of the coarsest level>|<rows>|<cols>|<tile size>|<levels>|<provider id>
+    // followed by the coarsest level, the server pulls the finer tiles when it needs them
+    template <typename T>
+    std::size_t send_container(zmq::socket_t& socket, const std::string& key, const image_pyramid<T>& pyramid)
+    {
+      const std::size_t top = pyramid.n_levels() - 1u;
+      std::string header{"pyramid|"};
+      header += key;
+      header.append("|");
+      header += std::string{unpack_type<T>().typestr};
+      header.append("|");
+      header += shape_str(std::array<std::size_t, 2>{pyramid.rows(top), pyramid.cols(top)});
+      for (std::size_t field : {pyramid.rows(), pyramid.cols(), pyramid.tile_size(), pyramid.n_levels()})
+      {
+        header.append("|");
+        header += std::to_string(field);
+      }
+      header.append("|");
+      header += std::to_string(pyramid.provider_id());
+
+      zmq::message_t msg(header.c_str(), header.length());
+      socket.send(msg, zmq::send_flags::sndmore);
+      zmq::message_t payload;
+      payload.rebuild((void*)pyramid.data(top), sizeof(T)*pyramid.rows(top)*pyramid.cols(top), custom_dealloc, zero_copy_tracker::track());
+      std::size_t n_bytes = header.length() + payload.size();
+      socket.send(payload, zmq::send_flags::sndmore);
+      return n_bytes;
+    }
+
+    // series|<key>|<type>|<samples>|<first x>|<last x>|<min>|<max>|<provider id>, no payload,
+    // the server pulls the visible range at screen resolution when it plots the series
+    template <typename T>
+    std::size_t send_container(zmq::socket_t& socket, const std::string& key, const zoom_series<T>& series)
+    {
+      const auto [y_min, y_max] = series.minmax(0u, series.size());
+      std::ostringstream header;
+      header << std::setprecision(std::numeric_limits<double>::max_digits10);
+      header << "series|" << key << '|' << unpack_type<T>().typestr << '|' << series.size() << '|'
+             << series.x(0u) << '|' << series.x(series.size() - 1u) << '|'
+             << static_cast<double>(y_min) << '|' << static_cast<double>(y_max) << '|' << series.provider_id();
+
+      const std::string header_str = header.str();
+      zmq::message_t msg(header_str.c_str(), header_str.length());
+      socket.send(msg, zmq::send_flags::sndmore);
+      return header_str.length();
+    }
+
+    // export|<key>|<provider id>, no payload, the server notifies the provider once the animation is written
+    std::size_t send_container(zmq::socket_t& socket, const std::string& key, const animation_export& job)
+    {
+      const std::string header = "export|"s + key + "|"s + std::to_string(job.provider_id());
+      zmq::message_t msg(header.c_str(), header.length());
+      socket.send(msg, zmq::send_flags::sndmore);
+      return header.length();
+    }
+
+    // arrow|<key>|<rows>|<frames> followed by the frames of an Arrow IPC stream, the schema message,
+    // the record batch message and the column buffers, padded to 8 bytes by frames of their own
+    std::size_t send_container(zmq::socket_t& socket, const std::string& key, const record_batch& batch)
+    {
+      const std::size_t n_rows = batch.rows();
+      std::vector<zmq::message_t> frames;
+      frames.emplace_back(batch.schema_message().data(), batch.schema_message().size());
+      batch.fill_frames(n_rows, frames);
+
+      std::string header{"arrow|"};
+      header += key;
+      header.append("|");
+      header += std::to_string(n_rows);
+      header.append("|");
+      header += std::to_string(frames.size());
+
+      zmq::message_t msg(header.c_str(), header.length());
+      socket.send(msg, zmq::send_flags::sndmore);
+      std::size_t n_bytes = header.length();
+      for (auto& frame : frames)
+      {
+        n_bytes += frame.size();
+        socket.send(frame, zmq::send_flags::sndmore);
+      }
+      return n_bytes;
+    }
+
+    // last part of every plot, carries the frame sequence number and submission time for latency tracking
+    void send_finalize(session& target, zmq::socket_t& socket, frame_clock::time_point t_submit, std::size_t n_bytes)
+    {
+      std::string final{"finalize|"};
+      final += std::to_string(target.next_frame_seq());
+      final.append("|");
+      final += std::to_string(to_wire_time(t_submit));
+
+      zmq::message_t msg(final.c_str(), final.length());
+      socket.send(msg, zmq::send_flags::none);
+      target.record_sent(t_submit, n_bytes + final.length());
     }
 
     template<typename... Val_t>
     void data_args(std::pair<std::string, Val_t>&&... args)
     {
-      zmq::message_t cmds(plot_cmds_.str());
-      cppyplot::socket_.send(cmds, zmq::send_flags::none);
+      if constexpr (sent_as_frame<std::decay_t<Val_t>...>())
+      {
+        data_packed([&](session& target, zmq::socket_t& socket)
+        { return send_frame<std::decay_t<Val_t>...>(target, socket, {std::string_view{args.first}...}, args.second...); });
+      }
+      else
+      {
+        packed_payloads packed;
+        (packed.add(args.second), ...);
+        packed.pack();
 
-      (send_container(args.first, args.second), ...);
+        data_packed([&](zmq::socket_t& socket)
+        {
+          std::size_t n_bytes = 0u;
+          ((n_bytes += send_container(socket, args.first, args.second)), ...);
+          return n_bytes;
+        });
+      }
+    }
 
-      std::this_thread::sleep_for(5ms); // small delay which helps in eliminating packet loss
-      zmq::message_t final("finalize", 8);
-      cppyplot::socket_.send(final, zmq::send_flags::none);
+    // sends the staged commands with the containers send_data(socket) adds, send_data returns their size in bytes.
+    // For senders whose containers are only known at runtime, e.g. point_batch
+    template<typename Send_t>
+    void data_packed(Send_t&& send_data)
+    {
+      send_parts(plot_cmds().str(), std::forward<Send_t>(send_data));
 
       /* reset */
-      plot_cmds_.str("");
+      plot_cmds().str("");
     }
-};
 
-// initialize static variables
-zmq::context_t cppyplot::context_             = zmq::context_t(1);
-zmq::socket_t  cppyplot::socket_              = zmq::socket_t(cppyplot::context_, ZMQ_PUB);
-bool           cppyplot::is_zmq_established_  = false;
-std::string    cppyplot::python_path_{PYTHON_PATH};
-std::string    cppyplot::zmq_ip_addr_{HOST_ADDR};
+    // hand new data to an artist created by earlier commands, e.g. `line, = ax.plot(x, y)` then update_artist("line", _p(x), _p(y)).
+    // The server sets it with set_data/set_offsets/set_array and redraws only the artist, no commands are evaluated
+    template<typename... Val_t>
+    void update_artist(const std::string& artist, std::pair<std::string, Val_t>&&... args)
+    {
+      packed_payloads packed;
+      (packed.add(args.second), ...);
+      packed.pack();
 
-// utility functions
-auto non_empty_line_idx(const std::string_view in_str)
-{
-  int new_line_pos        = -1;
-  unsigned int num_spaces = 0u;
-  for (unsigned int i = 0u; i < in_str.length(); i++)
-  {
-    if (in_str[i] == '\n')
-    { new_line_pos = i; num_spaces = 0u; }
-    else if (    (in_str[i] != ' ' ) 
-              && (in_str[i] != '\t'))
-    { break; }
-    else
-    { num_spaces ++; }
-  }
-  return std::make_tuple(new_line_pos+1, num_spaces);
-}
+      send_parts("artist|"s + artist, [&](zmq::socket_t& socket)
+      {
+        std::size_t n_bytes = 0u;
+        ((n_bytes += send_container(socket, args.first, args.second)), ...);
+        return n_bytes;
+      });
+    }
 
-std::string dedent_string(const std::string_view raw_str)
-{
-  auto [occupied_line_start, num_spaces] = non_empty_line_idx(raw_str);
-  if (num_spaces == 0u)
-  { return std::string(raw_str); }
-  else
-  {
-    std::string out_str;
-    out_str.reserve(raw_str.length());
-    
-    int line_start = -1;
-    bool process_spaces = true;
-    int cur_space_count = 0;
-    for (unsigned int i = static_cast<unsigned int>(occupied_line_start); i < raw_str.length(); i++)
+    // frame|<schema id> and one payload with every container at the offset of the schema, the schema
+    // layout is sent ahead when session::schema_due asks for it
+    template<typename... T>
+    std::size_t send_frame(session& target, zmq::socket_t& socket, const std::array<std::string_view, sizeof...(T)>& names, const T&... conts)
     {
-      if (process_spaces == true)
+      using schema = frame_schema<T...>;
+      const std::uint64_t schema_id = schema::id(names);
+      std::size_t n_bytes = 0u;
+      if (target.schema_due(schema_id) == true)
       {
-        if (raw_str[i] == '\n')
-        { 
-          process_spaces  = true;
-          line_start      = -1;
-          cur_space_count = 0;
-        }
-        else if ((raw_str[i] != ' ') && (raw_str[i] != '\t'))
-        {
-          process_spaces = false;
-          line_start     = i;
-        }
-        else
-        { cur_space_count++; }
+        zmq::message_t layout(schema::layout(schema_id, names));
+        n_bytes += layout.size();
+        socket.send(layout, zmq::send_flags::sndmore);
       }
-      else if (raw_str[i] == '\n')
+
+      const std::string header = "frame|"s + std::to_string(schema_id);
+      zmq::message_t msg(header.c_str(), header.length());
+      socket.send(msg, zmq::send_flags::sndmore);
+
+      zmq::message_t payload(schema::n_bytes);
+      schema::pack(static_cast<char*>(payload.data()), conts...);
+      n_bytes += header.length() + payload.size();
+      socket.send(payload, zmq::send_flags::sndmore);
+      return n_bytes;
+    }
+
+    // one plot: first part (commands or an artist update), the containers send_data adds and the finalize part.
+    // send_data(socket), or send_data(session, socket) for senders that depend on the server they are sent to
+    template<typename Send_t>
+    void send_parts(const std::string& first_part, Send_t&& send_data)
+    {
+      // the whole plot is one multipart message, parts of plots from other threads can not interleave
+      const auto t_submit = frame_clock::now();
+      session& target = route();
+      zmq::socket_t& socket = target.producer_socket();
+
+      // containers must stay untouched until zmq released every zero-copy payload
+      zero_copy_tracker zero_copy_payloads;
+      packed_payloads::stream_active(socket);
+
+      zmq::message_t head(first_part);
+      std::size_t n_bytes = head.size();
+      socket.send(head, zmq::send_flags::sndmore);
+
+      if constexpr (std::is_invocable_v<Send_t, session&, zmq::socket_t&>)
+      { n_bytes += send_data(target, socket); }
+      else
+      { n_bytes += send_data(socket); }
+
+      send_finalize(target, socket, t_submit, n_bytes);
+    }
+
+    template <typename T>
+    std::size_t send_recv_request(zmq::socket_t& socket, std::uint64_t req_id, const std::string& key, const T& cont)
+    {
+      (void)cont;
+      std::string request{"recv|"};
+      request += std::to_string(req_id);
+      request.append("|");
+      request += key;
+      request.append("|");
+      request += std::string{unpack_type<T>().typestr};
+      request.append("|");
+      request += std::string{storage_order<T>::value};
+
+      zmq::message_t msg(request.c_str(), request.length());
+      socket.send(msg, zmq::send_flags::sndmore);
+      return request.length();
+    }
+
+    // like data_args, additionally blocks until every variable in 'outs' is received back from the server
+    template<typename... Out_t, typename... Val_t>
+    void data_recv(recv_args<Out_t...>&& outs, std::pair<std::string, Val_t>&&... args)
+    {
+      packed_payloads packed;
+      (packed.add(args.second), ...);
+      packed.pack();
+
+      session& target = route();
+      auto lock = target.lock_replies();
+      const auto t_submit = frame_clock::now();
+      const std::uint64_t req_id = target.next_request_id();
       {
-        if (line_start != -1)
-        {
-          line_start -= (cur_space_count - num_spaces);
-          out_str.append(raw_str.substr(line_start, i - line_start + 1u)); 
-        }
-        process_spaces  = true;
-        line_start      = -1;
-        cur_space_count = 0;
+        zmq::socket_t& socket = target.producer_socket();
+        zero_copy_tracker zero_copy_payloads;
+        packed_payloads::stream_active(socket);
+
+        zmq::message_t cmds(plot_cmds().str());
+        std::size_t n_bytes = cmds.size();
+        socket.send(cmds, zmq::send_flags::sndmore);
+
+        ((n_bytes += send_container(socket, args.first, args.second)), ...);
+        std::apply([&](auto&... out){ ((n_bytes += send_recv_request(socket, req_id, out.first, out.second)), ...); }, outs.args);
+
+        send_finalize(target, socket, t_submit, n_bytes);
+
+        /* reset */
+        plot_cmds().str("");
       }
+      std::apply([&](auto&... out){ (target.recv_reply(req_id, out.first, out.second), ...); }, outs.args);
+      target.record_round_trip(t_submit);
     }
-    return out_str;
-  }
-}
+};
 
 template<typename T>
 std::string shape_str(const T& shape)
@@ -302,4 +835,11 @@ std::string shape_str(const T& shape)
 
 }
 
+#include "cppyplot_batch.h"
+#include "cppyplot_conflate.h"
+
+#ifndef CPPYPLOT_COMPILED_LIB
+  #include "cppyplot_impl.h"
+#endif
+
 #endif
@@ -0,0 +1,72 @@
+#ifndef _CPPYPLOT_ANIMATION_H_
+#define _CPPYPLOT_ANIMATION_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <zmq.hpp>
+
+namespace Cppyplot
+{
+
+/*
+  * Completion of an animation the server exports in the background. Sent with _p(job), the plot commands
+  * call job.save(anim, path) instead of anim.save(path): the server renders frame ranges on its export workers,
+  * encodes them into the file and notifies this object once it is written, plots sent meanwhile are not held up.
+  * One export per object, it has to outlive the export to be notified.
+*/
+class animation_export{
+  public:
+    enum class status { pending, done, failed };
+
+    // on_finish is called from the session's forwarder thread once the export finished or failed, after the
+    // server was answered. It may plot and create or destroy other data providers, but not destroy this object,
+    // whose destructor waits for on_finish to return. Tile and range requests wait while it runs
+    explicit animation_export(std::function<void(const animation_export&)> on_finish = {});
+
+    animation_export(const animation_export& other) = delete;
+    animation_export& operator=(const animation_export& other) = delete;
+
+    ~animation_export();
+
+    std::uint64_t provider_id() const noexcept
+    { return provider_id_; }
+
+    status state() const;
+
+    // blocks until the export finished or failed, or timeout passed
+    status wait_for(std::chrono::milliseconds timeout) const;
+    status wait() const;
+
+    // written file, frames and seconds from job.save until the file was written, once done
+    std::string path() const;
+    std::size_t frames() const;
+    double      seconds() const;
+
+    // reason the export failed
+    std::string error() const;
+
+  private:
+    // done|<path>|<frames>|<seconds> or failed|<message>
+    void notify(const std::vector<std::string>& args, std::vector<zmq::message_t>& reply);
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable finished_;
+    status      state_ = status::pending;
+    std::string path_;
+    std::string error_;
+    std::size_t frames_ = 0u;
+    double      seconds_ = 0.0;
+    bool        finishing_ = false;   // on_finish is pending or running
+    std::function<void(const animation_export&)> on_finish_;
+    std::uint64_t provider_id_ = 0u;
+};
+
+}
+
+#endif
@@ -0,0 +1,376 @@
+#ifndef _CPPYPLOT_ARROW_H_
+#define _CPPYPLOT_ARROW_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <zmq.hpp>
+
+/*
+  * Columns sent as one table in the Arrow IPC format, https://arrow.apache.org/docs/format/Columnar.html
+  * The schema and record batch messages are encoded here, the column buffers are the containers themselves
+  * and are sent zero-copy wherever the container is contiguous. The server builds a pandas DataFrame over them.
+*/
+
+namespace Cppyplot
+{
+
+namespace arrow_ipc
+{
+
+inline std::size_t align_up(std::size_t value, std::size_t alignment) noexcept
+{ return ((value + alignment - 1u)/alignment)*alignment; }
+
+// zero bytes until (size + extra) is a multiple of alignment
+inline void pad(std::string& buf, std::size_t alignment, std::size_t extra = 0u)
+{ buf.append(align_up(buf.size() + extra, alignment) - (buf.size() + extra), '\0'); }
+
+template<typename T>
+inline void put(std::string& buf, std::size_t pos, T value) noexcept
+{ std::memcpy(&buf[pos], &value, sizeof(T)); }
+
+template<typename T>
+inline std::size_t append(std::string& buf, T value)
+{
+  const std::size_t pos = buf.size();
+  buf.append(sizeof(T), '\0');
+  put(buf, pos, value);
+  return pos;
+}
+
+// writes an object into the flatbuffer and returns its position
+using fb_writer = std::function<std::size_t(std::string& buf)>;
+
+/*
+  * Minimal flatbuffers table writer for the Arrow metadata. A table is written before its children,
+  * so every offset points forward, its vtable is placed right in front of it
+*/
+class fb_table{
+  private:
+    struct entry{
+      std::uint16_t id;
+      std::size_t   size;        // inline bytes, 4 for offsets to children
+      std::uint64_t bytes = 0u;  // scalar value
+      fb_writer     child;
+    };
+    std::vector<entry> entries_;
+
+  public:
+    template<typename T>
+    fb_table& scalar(std::uint16_t id, T value)
+    {
+      static_assert(std::is_integral_v<T>, "flatbuffer scalars are integral");
+      entry field{id, sizeof(T), 0u, {}};
+      std::memcpy(&field.bytes, &value, sizeof(T));
+      entries_.push_back(std::move(field));
+      return *this;
+    }
+
+    fb_table& child(std::uint16_t id, fb_writer writer)
+    {
+      entries_.push_back(entry{id, sizeof(std::uint32_t), 0u, std::move(writer)});
+      return *this;
+    }
+
+    std::size_t write(std::string& buf) const
+    {
+      // widest fields first, the table starts 8 byte aligned so each field is aligned to its size
+      std::vector<const entry*> order;
+      std::uint16_t n_slots = 0u;
+      for (const auto& field : entries_)
+      {
+        order.push_back(&field);
+        n_slots = std::max<std::uint16_t>(n_slots, static_cast<std::uint16_t>(field.id + 1u));
+      }
+      std::stable_sort(order.begin(), order.end(), [](const entry* a, const entry* b){ return a->size > b->size; });
+
+      std::vector<std::uint16_t> slots(n_slots, 0u);
+      std::size_t inline_size = sizeof(std::int32_t);
+      for (const entry* field : order)
+      {
+        inline_size = align_up(inline_size, field->size);
+        slots[field->id] = static_cast<std::uint16_t>(inline_size);
+        inline_size += field->size;
+      }
+
+      pad(buf, 2u);
+      const std::size_t vtable_pos = buf.size();
+      append<std::uint16_t>(buf, static_cast<std::uint16_t>(2u*(2u + n_slots)));
+      append<std::uint16_t>(buf, static_cast<std::uint16_t>(inline_size));
+      for (std::uint16_t slot : slots)
+      { append<std::uint16_t>(buf, slot); }
+
+      pad(buf, 8u);
+      const std::size_t table_pos = buf.size();
+      buf.append(inline_size, '\0');
+      put<std::int32_t>(buf, table_pos, static_cast<std::int32_t>(table_pos - vtable_pos));
+      for (const auto& field : entries_)
+      {
+        if (!field.child)
+        { std::memcpy(&buf[table_pos + slots[field.id]], &field.bytes, field.size); }
+      }
+      for (const auto& field : entries_)
+      {
+        if (field.child)
+        {
+          const std::size_t field_pos = table_pos + slots[field.id];
+          const std::size_t child_pos = field.child(buf);
+          put<std::uint32_t>(buf, field_pos, static_cast<std::uint32_t>(child_pos - field_pos));
+        }
+      }
+      return table_pos;
+    }
+};
+
+inline fb_writer fb_child(fb_table table)
+{ return [table = std::move(table)](std::string& buf){ return table.write(buf); }; }
+
+inline fb_writer fb_string(std::string str)
+{
+  return [str = std::move(str)](std::string& buf)
+  {
+    pad(buf, 4u);
+    const std::size_t pos = append<std::uint32_t>(buf, static_cast<std::uint32_t>(str.size()));
+    buf += str;
+    buf.push_back('\0');
+    return pos;
+  };
+}
+
+inline fb_writer fb_tables(std::vector<fb_table> tables)
+{
+  return [tables = std::move(tables)](std::string& buf)
+  {
+    pad(buf, 4u);
+    const std::size_t pos = append<std::uint32_t>(buf, static_cast<std::uint32_t>(tables.size()));
+    buf.append(sizeof(std::uint32_t)*tables.size(), '\0');
+    for (std::size_t i = 0u; i < tables.size(); i++)
+    {
+      const std::size_t slot_pos  = pos + sizeof(std::uint32_t)*(i + 1u);
+      const std::size_t table_pos = tables[i].write(buf);
+      put<std::uint32_t>(buf, slot_pos, static_cast<std::uint32_t>(table_pos - slot_pos));
+    }
+    return pos;
+  };
+}
+
+// vector of structs made of int64 fields, the elements are 8 byte aligned
+inline fb_writer fb_structs(std::vector<std::int64_t> fields, std::size_t fields_per_struct)
+{
+  return [fields = std::move(fields), fields_per_struct](std::string& buf)
+  {
+    pad(buf, 8u, sizeof(std::uint32_t));
+    const std::size_t pos = append<std::uint32_t>(buf, static_cast<std::uint32_t>(fields.size()/fields_per_struct));
+    for (std::int64_t field : fields)
+    { append<std::int64_t>(buf, field); }
+    return pos;
+  };
+}
+
+// Schema.fbs and Message.fbs enums
+inline constexpr std::int16_t metadata_v5         = 4;
+inline constexpr std::uint8_t header_schema       = 1u;
+inline constexpr std::uint8_t header_record_batch = 3u;
+inline constexpr std::uint8_t type_int            = 2u;
+inline constexpr std::uint8_t type_floating_point = 3u;
+inline constexpr std::uint8_t type_utf8           = 5u;
+
+// encapsulated message: continuation marker, metadata size and the flatbuffer padded to 8 bytes, the body follows
+inline std::string message(std::uint8_t header_type, fb_table header, std::int64_t body_length)
+{
+  fb_table msg;
+  msg.scalar<std::int16_t>(0u, metadata_v5)
+     .scalar<std::uint8_t>(1u, header_type)
+     .child(2u, fb_child(std::move(header)))
+     .scalar<std::int64_t>(3u, body_length);
+
+  std::string flatbuffer(sizeof(std::uint32_t), '\0');
+  put<std::uint32_t>(flatbuffer, 0u, static_cast<std::uint32_t>(msg.write(flatbuffer)));
+
+  std::string out;
+  append<std::uint32_t>(out, 0xFFFFFFFFu);
+  const std::size_t padded = align_up(flatbuffer.size(), 8u);
+  append<std::int32_t>(out, static_cast<std::int32_t>(padded));
+  out += flatbuffer;
+  out.append(padded - flatbuffer.size(), '\0');
+  return out;
+}
+
+// Field of a column without nulls, typestr as in cppyplot_types.h, 's' for utf8 strings
+inline fb_table field(const std::string& name, char typestr, std::size_t elem_size)
+{
+  fb_table type;
+  std::uint8_t type_type = type_int;
+  switch (typestr)
+  {
+    case 'f': type_type = type_floating_point; type.scalar<std::int16_t>(0u, 1); break;
+    case 'd': type_type = type_floating_point; type.scalar<std::int16_t>(0u, 2); break;
+    case 's': type_type = type_utf8; break;
+    default:
+      type.scalar<std::int32_t>(0u, static_cast<std::int32_t>(8u*elem_size))
+          .scalar<std::uint8_t>(1u, ((typestr >= 'a') && (typestr <= 'z')) ? 1u : 0u);
+  }
+
+  fb_table out;
+  out.child(0u, fb_string(name))
+     .scalar<std::uint8_t>(1u, 0u)
+     .scalar<std::uint8_t>(2u, type_type)
+     .child(3u, fb_child(std::move(type)))
+     .child(5u, fb_tables({}));
+  return out;
+}
+
+}
+
+/*
+  * Named columns plotted as one table, e.g. record_batch points(_p(x), _p(y), _p(label)).
+  * Columns are 1D containers of arithmetic types or std::vector<std::string>, all of the same length when sent.
+  * The containers are referenced, not copied, and are read again every time the batch is sent,
+  * so they can grow between plots but have to outlive the batch.
+  * The server binds the name to a pandas DataFrame whose numeric columns are views over the received buffers.
+*/
+class record_batch{
+  private:
+    struct column_t{
+      std::function<std::size_t()> rows;
+      // appends the buffers of the column, offsets and characters for strings, returns how many
+      std::function<std::size_t(std::vector<zmq::message_t>& frames)> fill;
+    };
+    std::vector<column_t> columns_;
+    std::string schema_;
+
+    template<typename Cont>
+    arrow_ipc::fb_table add_column(const std::string& name, const Cont& cont)
+    {
+      if constexpr (is_string_v<typename Cont::value_type>)
+      {
+        columns_.push_back(column_t{[&cont](){ return static_cast<std::size_t>(std::size(cont)); },
+                                    [&cont](std::vector<zmq::message_t>& frames){ return fill_utf8(cont, frames); }});
+        return arrow_ipc::field(name, 's', 1u);
+      }
+      else
+      {
+        columns_.push_back(column_t{[&cont](){ return container_size(cont); },
+                                    [&cont](std::vector<zmq::message_t>& frames)
+                                    {
+                                      frames.emplace_back();
+                                      fill_zmq_buffer(cont, frames.back());
+                                      return std::size_t{1u};
+                                    }});
+        constexpr auto elem_type = unpack_type<Cont>();
+        return arrow_ipc::field(name, elem_type.typestr, elem_type.elem_size);
+      }
+    }
+
+    // int32 offsets followed by the concatenated characters
+    template<typename Cont>
+    static std::size_t fill_utf8(const Cont& strings, std::vector<zmq::message_t>& frames)
+    {
+      std::size_t n_chars = 0u;
+      for (const auto& str : strings)
+      { n_chars += str.size(); }
+      if (n_chars > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+      { throw std::length_error("cppyplot: record_batch string columns hold up to 2 GB of characters"); }
+
+      zmq::message_t offsets(sizeof(std::int32_t)*(std::size(strings) + 1u));
+      zmq::message_t chars(n_chars);
+      auto* offset = static_cast<std::int32_t*>(offsets.data());
+      auto* out    = static_cast<char*>(chars.data());
+      *offset = 0;
+      for (const auto& str : strings)
+      {
+        std::memcpy(out + *offset, str.data(), str.size());
+        *(offset + 1) = *offset + static_cast<std::int32_t>(str.size());
+        offset++;
+      }
+      frames.push_back(std::move(offsets));
+      frames.push_back(std::move(chars));
+      return 2u;
+    }
+
+  public:
+    template<typename... Cont_t>
+    explicit record_batch(std::pair<std::string, Cont_t>&&... columns)
+    {
+      static_assert((std::is_lvalue_reference_v<Cont_t> && ...), "record_batch references its columns, pass them with _p");
+      std::vector<arrow_ipc::fb_table> fields;
+      (fields.push_back(add_column(columns.first, columns.second)), ...);
+
+      arrow_ipc::fb_table schema;
+      schema.scalar<std::int16_t>(0u, 0)   // little endian
+            .child(1u, arrow_ipc::fb_tables(std::move(fields)));
+      schema_ = arrow_ipc::message(arrow_ipc::header_schema, std::move(schema), 0);
+    }
+
+    record_batch(const record_batch& other) = delete;
+    record_batch& operator=(const record_batch& other) = delete;
+
+    std::size_t n_columns() const noexcept
+    { return columns_.size(); }
+
+    // rows of every column, throws std::length_error if they differ
+    std::size_t rows() const
+    {
+      const std::size_t n_rows = columns_.empty() ? 0u : columns_.front().rows();
+      for (const auto& col : columns_)
+      {
+        if (col.rows() != n_rows)
+        { throw std::length_error("cppyplot: record_batch columns differ in length"); }
+      }
+      return n_rows;
+    }
+
+    // encapsulated IPC schema message, built once
+    const std::string& schema_message() const noexcept
+    { return schema_; }
+
+    /*
+      * Appends the IPC record batch message and its body. Every body buffer that is not a multiple of 8 bytes long
+      * is followed by a frame with its padding, so the schema message and the frames form a valid IPC stream
+    */
+    void fill_frames(std::size_t n_rows, std::vector<zmq::message_t>& frames) const
+    {
+      std::vector<zmq::message_t> body;
+      std::vector<std::int64_t> nodes, buffers;
+      std::int64_t offset = 0;
+      for (const auto& col : columns_)
+      {
+        nodes.insert(nodes.end(), {static_cast<std::int64_t>(n_rows), 0});
+        buffers.insert(buffers.end(), {offset, 0});  // no validity bitmap, nothing is null
+        const std::size_t n_buffers = col.fill(body);
+        for (std::size_t b = body.size() - n_buffers; b < body.size(); b++)
+        {
+          buffers.insert(buffers.end(), {offset, static_cast<std::int64_t>(body[b].size())});
+          offset += static_cast<std::int64_t>(arrow_ipc::align_up(body[b].size(), 8u));
+        }
+      }
+
+      arrow_ipc::fb_table batch;
+      batch.scalar<std::int64_t>(0u, static_cast<std::int64_t>(n_rows))
+           .child(1u, arrow_ipc::fb_structs(std::move(nodes), 2u))
+           .child(2u, arrow_ipc::fb_structs(std::move(buffers), 2u));
+      const std::string metadata = arrow_ipc::message(arrow_ipc::header_record_batch, std::move(batch), offset);
+      frames.emplace_back(metadata.data(), metadata.size());
+
+      static constexpr char zeros[8] = {};
+      for (auto& buffer : body)
+      {
+        const std::size_t padding = arrow_ipc::align_up(buffer.size(), 8u) - buffer.size();
+        frames.push_back(std::move(buffer));
+        if (padding > 0u)
+        { frames.emplace_back(zeros, padding); }
+      }
+    }
+};
+
+}
+
+#endif
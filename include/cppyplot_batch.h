@@ -0,0 +1,146 @@
+#ifndef _CPPYPLOT_BATCH_H_
+#define _CPPYPLOT_BATCH_H_
+
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <zmq.hpp>
+
+namespace Cppyplot
+{
+
+// a point_batch sends what it buffered as soon as one of the limits is reached
+struct flush_policy{
+  std::size_t max_points = 256u;              // buffered calls per flush
+  std::chrono::milliseconds max_delay{50};    // age of the oldest buffered point, checked on push, zero disables it
+  bool keep_last = false;                     // start every batch with the last point of the previous one, connects line segments
+};
+
+/*
+  * Accumulates the scalar arguments of many push calls into one array per name and sends them as a single plot.
+  * The plot commands run once per flush with every name bound to the numpy array of its buffered values,
+  * so commands written for a single point, e.g. plt.scatter(i, data), plot the whole batch unchanged.
+  * Every push has to pass the same names of the same types in the same order.
+  * Not thread-safe, use one batch per producer thread. Whatever is buffered is sent on destruction.
+*/
+class point_batch{
+  private:
+    struct column_base{
+      std::string key;
+      explicit column_base(std::string name) : key(std::move(name)) {}
+      virtual ~column_base() = default;
+      virtual std::size_t send(cppyplot& pyp, zmq::socket_t& socket) = 0;
+      virtual void restart(bool keep_last) noexcept = 0;
+    };
+
+    template<typename T>
+    struct column : column_base{
+      std::vector<T> values;
+      column(std::string name, std::size_t capacity) : column_base(std::move(name))
+      { values.reserve(capacity + 1u); }
+
+      std::size_t send(cppyplot& pyp, zmq::socket_t& socket) override
+      { return pyp.send_container(socket, key, values); }
+
+      void restart(bool keep_last) noexcept override
+      { values.erase(values.begin(), (keep_last == true) ? std::prev(values.end()) : values.end()); }
+    };
+
+    cppyplot&    pyp_;
+    std::string  cmds_;
+    flush_policy policy_;
+    std::vector<std::unique_ptr<column_base>> columns_;
+    std::size_t  n_points_ = 0u;   // pushed since the last flush
+    bool         shaped_ = false;  // names and types are fixed by the first push
+    std::chrono::steady_clock::time_point oldest_point_;
+
+    // column idx of the current point, created on the first push only
+    template<typename T>
+    column<T>& column_at(std::size_t idx, const std::string& key)
+    {
+      static_assert(std::is_arithmetic_v<T>, "point_batch buffers scalars, send containers with data_args");
+      if ((idx == columns_.size()) && (shaped_ == false))
+      { columns_.push_back(std::make_unique<column<T>>(key, policy_.max_points)); }
+
+      auto* col = (idx < columns_.size()) ? dynamic_cast<column<T>*>(columns_[idx].get()) : nullptr;
+      if ((col == nullptr) || (col->key != key))
+      { throw std::runtime_error("cppyplot: point_batch arguments must keep their name, type and order, got '"s + key + "'"s); }
+      return *col;
+    }
+
+  public:
+    point_batch(cppyplot& pyp, std::string_view cmds, flush_policy policy = flush_policy{})
+      : pyp_(pyp), cmds_(dedent_string(cmds)), policy_(policy)
+    {
+      if (policy_.max_points == 0u)
+      { policy_.max_points = 1u; }
+    }
+
+    point_batch(const point_batch& other) = delete;
+    point_batch& operator=(const point_batch& other) = delete;
+
+    ~point_batch()
+    {
+      // a server that failed can not take the rest anymore, it is dropped
+      try { flush(); }
+      catch (...) {}
+    }
+
+    // buffer one point, e.g. batch.push(_p(value), _p(time)). Flushes once the policy says so
+    template<typename... Val_t>
+    void push(std::pair<std::string, Val_t>&&... args)
+    {
+      // check every argument before appending, columns never differ in length
+      std::size_t idx = 0u;
+      (column_at<std::decay_t<Val_t>>(idx++, args.first), ...);
+      if (idx != columns_.size())
+      { throw std::runtime_error("cppyplot: point_batch expected "s + std::to_string(columns_.size()) + " arguments per point"s); }
+      shaped_ = true;
+
+      idx = 0u;
+      (static_cast<column<std::decay_t<Val_t>>&>(*columns_[idx++]).values.push_back(args.second), ...);
+
+      if (n_points_++ == 0u)
+      { oldest_point_ = std::chrono::steady_clock::now(); }
+
+      if (   (n_points_ >= policy_.max_points)
+          || (   (policy_.max_delay.count() > 0)
+              && ((std::chrono::steady_clock::now() - oldest_point_) >= policy_.max_delay)) )
+      { flush(); }
+    }
+
+    // send everything buffered as one plot, nothing is sent if no point was pushed since the last flush
+    void flush()
+    {
+      if (n_points_ == 0u)
+      { return; }
+
+      pyp_.push(cmds_);
+      pyp_.data_packed([this](zmq::socket_t& socket)
+      {
+        std::size_t n_bytes = 0u;
+        for (auto& col : columns_)
+        { n_bytes += col->send(pyp_, socket); }
+        return n_bytes;
+      });
+
+      // zmq released the buffers once data_packed returned
+      for (auto& col : columns_)
+      { col->restart(policy_.keep_last); }
+      n_points_ = 0u;
+    }
+
+    // points waiting for the next flush
+    std::size_t size() const noexcept
+    { return n_points_; }
+};
+
+}
+
+#endif
@@ -0,0 +1,382 @@
+#ifndef _CPPYPLOT_BINNING_H_
+#define _CPPYPLOT_BINNING_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <zmq.hpp>
+
+/*
+  * Histograms computed in c++, only the bin counts are sent to the server instead of every sample.
+  * Bins are fixed when a histogram is created, add() can be called any number of times to stream samples in.
+  * histogram and histogram2d are containers themselves, _p(hist) sends the counts as a 1D array and
+  * _p(heat) as a (ny, nx) array ready for imshow(origin='lower') or pcolormesh.
+*/
+
+namespace Cppyplot
+{
+
+namespace binning
+{
+
+// below this many samples per thread binning stays on the calling thread
+inline constexpr std::size_t min_parallel_samples = std::size_t{1u} << 20u;
+
+// indices are computed for a block of samples first, so the compiler can vectorize that loop
+inline constexpr std::size_t block_size = 256u;
+
+/*
+  * Runs bin(begin, end, counts) over [0, n) split across threads, each with private counts,
+  * and sums the private counts into counts
+*/
+template<typename Count_t, typename Bin_t>
+void parallel_bin(std::size_t n, std::vector<Count_t>& counts, const Bin_t& bin)
+{
+  const std::size_t n_threads = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u),
+                                                      n/min_parallel_samples);
+  if (n_threads <= 1u)
+  {
+    bin(std::size_t{0u}, n, counts.data());
+    return;
+  }
+
+  const std::size_t chunk = n/n_threads;
+  std::vector<std::vector<Count_t>> partial(n_threads - 1u, std::vector<Count_t>(counts.size(), Count_t{0}));
+  std::vector<std::thread> workers;
+  workers.reserve(n_threads - 1u);
+  for (std::size_t t = 1u; t < n_threads; t++)
+  {
+    workers.emplace_back([&, t](){
+      bin(t*chunk, (t + 1u == n_threads) ? n : (t + 1u)*chunk, partial[t - 1u].data());
+    });
+  }
+  bin(std::size_t{0u}, chunk, counts.data());
+
+  for (std::size_t t = 0u; t < workers.size(); t++)
+  {
+    workers[t].join();
+    std::transform(counts.begin(), counts.end(), partial[t].begin(), counts.begin(), std::plus<Count_t>{});
+  }
+}
+
+// bin of value on an axis of n_bins starting at lo, n_bins for values outside and NaN
+inline std::size_t bin_index(double value, double lo, double inv_width, std::size_t n_bins) noexcept
+{
+  const double pos = (value - lo)*inv_width;
+  return ((pos >= 0.0) && (pos < static_cast<double>(n_bins))) ? static_cast<std::size_t>(pos) : n_bins;
+}
+
+template<typename Cont>
+std::size_t sample_count(const Cont& samples)
+{ return static_cast<std::size_t>(std::size(samples)); }
+
+inline std::vector<double> edges(std::size_t n_bins, double lo, double hi)
+{
+  std::vector<double> result(n_bins + 1u);
+  for (std::size_t i = 0u; i <= n_bins; i++)
+  { result[i] = lo + (hi - lo)*static_cast<double>(i)/static_cast<double>(n_bins); }
+  return result;
+}
+
+inline void check_range(std::size_t n_bins, double lo, double hi)
+{
+  if ((n_bins == 0u) || !(lo < hi))
+  { throw std::invalid_argument("cppyplot: bins need n_bins > 0 and lo < hi"); }
+}
+
+}
+
+/*
+  * n_bins equal bins over [lo, hi), samples outside the range are counted by outside()
+*/
+template<typename Count_t = std::uint64_t>
+class histogram{
+  private:
+    std::size_t n_bins_;
+    double      lo_, hi_, inv_width_;
+    std::vector<Count_t> counts_; // one more slot for samples outside
+
+  public:
+    using value_type = Count_t;
+
+    histogram(std::size_t n_bins, double lo, double hi)
+      : n_bins_(n_bins), lo_(lo), hi_(hi), inv_width_(static_cast<double>(n_bins)/(hi - lo))
+    {
+      binning::check_range(n_bins, lo, hi);
+      counts_.assign(n_bins_ + 1u, Count_t{0});
+    }
+
+    template<typename T>
+    void add(const T* samples, std::size_t n)
+    {
+      static_assert(std::is_arithmetic_v<T>, "histogram bins integral and floating point samples");
+      binning::parallel_bin(n, counts_, [&](std::size_t begin, std::size_t end, Count_t* counts)
+      {
+        std::array<std::size_t, binning::block_size> idx;
+        for (std::size_t block = begin; block < end; block += binning::block_size)
+        {
+          const std::size_t n_block = std::min(binning::block_size, end - block);
+          for (std::size_t k = 0u; k < n_block; k++)
+          { idx[k] = binning::bin_index(static_cast<double>(samples[block + k]), lo_, inv_width_, n_bins_); }
+          for (std::size_t k = 0u; k < n_block; k++)
+          { counts[idx[k]]++; }
+        }
+      });
+    }
+
+    // any contiguous container, e.g. std::vector, std::array or an Eigen vector
+    template<typename Cont>
+    void add(const Cont& samples)
+    { add(std::data(samples), binning::sample_count(samples)); }
+
+    void add_sample(double sample) noexcept
+    { counts_[binning::bin_index(sample, lo_, inv_width_, n_bins_)]++; }
+
+    void reset() noexcept
+    { std::fill(counts_.begin(), counts_.end(), Count_t{0}); }
+
+    const Count_t* counts() const noexcept
+    { return counts_.data(); }
+
+    std::size_t n_bins() const noexcept
+    { return n_bins_; }
+
+    Count_t outside() const noexcept
+    { return counts_[n_bins_]; }
+
+    // n_bins + 1 bin edges, e.g. for plt.stairs(hist, edges)
+    std::vector<double> edges() const
+    { return binning::edges(n_bins_, lo_, hi_); }
+};
+
+/*
+  * nx by ny equal bins over [x_lo, x_hi) x [y_lo, y_hi), counts are stored row-major with one row per y bin
+*/
+template<typename Count_t = std::uint64_t>
+class histogram2d{
+  private:
+    std::size_t nx_, ny_;
+    double      x_lo_, x_hi_, x_inv_width_;
+    double      y_lo_, y_hi_, y_inv_width_;
+    std::vector<Count_t> counts_; // one more slot for samples outside
+
+    std::size_t cell(double x, double y) const noexcept
+    {
+      const std::size_t ix = binning::bin_index(x, x_lo_, x_inv_width_, nx_);
+      const std::size_t iy = binning::bin_index(y, y_lo_, y_inv_width_, ny_);
+      return ((ix < nx_) && (iy < ny_)) ? (iy*nx_ + ix) : (nx_*ny_);
+    }
+
+  public:
+    using value_type = Count_t;
+
+    histogram2d(std::size_t nx, double x_lo, double x_hi, std::size_t ny, double y_lo, double y_hi)
+      : nx_(nx), ny_(ny),
+        x_lo_(x_lo), x_hi_(x_hi), x_inv_width_(static_cast<double>(nx)/(x_hi - x_lo)),
+        y_lo_(y_lo), y_hi_(y_hi), y_inv_width_(static_cast<double>(ny)/(y_hi - y_lo))
+    {
+      binning::check_range(nx, x_lo, x_hi);
+      binning::check_range(ny, y_lo, y_hi);
+      counts_.assign(nx_*ny_ + 1u, Count_t{0});
+    }
+
+    template<typename X_t, typename Y_t>
+    void add(const X_t* x, const Y_t* y, std::size_t n)
+    {
+      static_assert(std::is_arithmetic_v<X_t> && std::is_arithmetic_v<Y_t>, "histogram2d bins integral and floating point samples");
+      binning::parallel_bin(n, counts_, [&](std::size_t begin, std::size_t end, Count_t* counts)
+      {
+        std::array<std::size_t, binning::block_size> idx;
+        for (std::size_t block = begin; block < end; block += binning::block_size)
+        {
+          const std::size_t n_block = std::min(binning::block_size, end - block);
+          for (std::size_t k = 0u; k < n_block; k++)
+          { idx[k] = cell(static_cast<double>(x[block + k]), static_cast<double>(y[block + k])); }
+          for (std::size_t k = 0u; k < n_block; k++)
+          { counts[idx[k]]++; }
+        }
+      });
+    }
+
+    // x and y coordinates in two contiguous containers of the same size
+    template<typename X_cont, typename Y_cont>
+    void add(const X_cont& x, const Y_cont& y)
+    {
+      if (binning::sample_count(x) != binning::sample_count(y))
+      { throw std::invalid_argument("cppyplot: histogram2d needs as many x as y samples"); }
+      add(std::data(x), std::data(y), binning::sample_count(x));
+    }
+
+    void add_sample(double x, double y) noexcept
+    { counts_[cell(x, y)]++; }
+
+    void reset() noexcept
+    { std::fill(counts_.begin(), counts_.end(), Count_t{0}); }
+
+    const Count_t* counts() const noexcept
+    { return counts_.data(); }
+
+    std::size_t nx() const noexcept
+    { return nx_; }
+
+    std::size_t ny() const noexcept
+    { return ny_; }
+
+    Count_t outside() const noexcept
+    { return counts_[nx_*ny_]; }
+
+    std::vector<double> x_edges() const
+    { return binning::edges(nx_, x_lo_, x_hi_); }
+
+    std::vector<double> y_edges() const
+    { return binning::edges(ny_, y_lo_, y_hi_); }
+
+    // x_lo, x_hi, y_lo, y_hi, for imshow(heat, extent=extent, origin='lower')
+    std::array<double, 4> extent() const noexcept
+    { return {x_lo_, x_hi_, y_lo_, y_hi_}; }
+};
+
+/*
+  * Hexagonal bins laid out like matplotlib's hexbin with gridsize=(nx, ny) and the same extent.
+  * cells() gives the centers and counts of the non-empty hexagons, plotted with
+  * plt.hexbin(hx, hy, C=hc, gridsize=(nx, ny), extent=extent, reduce_C_function=np.sum)
+*/
+template<typename Count_t = std::uint64_t>
+class hexbin{
+  private:
+    std::size_t nx_, ny_;
+    double      x_lo_, x_hi_, sx_;
+    double      y_lo_, y_hi_, sy_;
+    std::vector<Count_t> counts_; // (nx+1)*(ny+1) hexagons on the lattice, nx*ny in between, one slot for samples outside
+
+    // nearest hexagon center out of the two lattices, as matplotlib's hexbin picks it
+    std::size_t cell(double x, double y) const noexcept
+    {
+      const double ix = (x - x_lo_)/sx_;
+      const double iy = (y - y_lo_)/sy_;
+      const double ix1 = std::nearbyint(ix), iy1 = std::nearbyint(iy);
+      const double ix2 = std::floor(ix),     iy2 = std::floor(iy);
+      const double d1 = (ix - ix1)*(ix - ix1) + 3.0*(iy - iy1)*(iy - iy1);
+      const double d2 = (ix - ix2 - 0.5)*(ix - ix2 - 0.5) + 3.0*(iy - iy2 - 0.5)*(iy - iy2 - 0.5);
+      const std::size_t n_lattice = (nx_ + 1u)*(ny_ + 1u);
+      if (d1 < d2)
+      {
+        const bool inside = (ix1 >= 0.0) && (ix1 <= static_cast<double>(nx_)) && (iy1 >= 0.0) && (iy1 <= static_cast<double>(ny_));
+        return (inside == true) ? static_cast<std::size_t>(ix1)*(ny_ + 1u) + static_cast<std::size_t>(iy1) : counts_.size() - 1u;
+      }
+      const bool inside = (ix2 >= 0.0) && (ix2 < static_cast<double>(nx_)) && (iy2 >= 0.0) && (iy2 < static_cast<double>(ny_));
+      return (inside == true) ? n_lattice + static_cast<std::size_t>(ix2)*ny_ + static_cast<std::size_t>(iy2) : counts_.size() - 1u;
+    }
+
+  public:
+    hexbin(std::size_t nx, double x_lo, double x_hi, std::size_t ny, double y_lo, double y_hi)
+      : nx_(nx), ny_(ny), x_lo_(x_lo), x_hi_(x_hi), sx_((x_hi - x_lo)/static_cast<double>(nx)),
+        y_lo_(y_lo), y_hi_(y_hi), sy_((y_hi - y_lo)/static_cast<double>(ny))
+    {
+      binning::check_range(nx, x_lo, x_hi);
+      binning::check_range(ny, y_lo, y_hi);
+      counts_.assign((nx_ + 1u)*(ny_ + 1u) + nx_*ny_ + 1u, Count_t{0});
+    }
+
+    template<typename X_t, typename Y_t>
+    void add(const X_t* x, const Y_t* y, std::size_t n)
+    {
+      static_assert(std::is_arithmetic_v<X_t> && std::is_arithmetic_v<Y_t>, "hexbin bins integral and floating point samples");
+      binning::parallel_bin(n, counts_, [&](std::size_t begin, std::size_t end, Count_t* counts)
+      {
+        std::array<std::size_t, binning::block_size> idx;
+        for (std::size_t block = begin; block < end; block += binning::block_size)
+        {
+          const std::size_t n_block = std::min(binning::block_size, end - block);
+          for (std::size_t k = 0u; k < n_block; k++)
+          { idx[k] = cell(static_cast<double>(x[block + k]), static_cast<double>(y[block + k])); }
+          for (std::size_t k = 0u; k < n_block; k++)
+          { counts[idx[k]]++; }
+        }
+      });
+    }
+
+    template<typename X_cont, typename Y_cont>
+    void add(const X_cont& x, const Y_cont& y)
+    {
+      if (binning::sample_count(x) != binning::sample_count(y))
+      { throw std::invalid_argument("cppyplot: hexbin needs as many x as y samples"); }
+      add(std::data(x), std::data(y), binning::sample_count(x));
+    }
+
+    void add_sample(double x, double y) noexcept
+    { counts_[cell(x, y)]++; }
+
+    void reset() noexcept
+    { std::fill(counts_.begin(), counts_.end(), Count_t{0}); }
+
+    // centers and counts of the non-empty hexagons, the vectors are overwritten
+    void cells(std::vector<double>& x, std::vector<double>& y, std::vector<Count_t>& counts) const
+    {
+      x.clear(); y.clear(); counts.clear();
+      const std::size_t n_lattice = (nx_ + 1u)*(ny_ + 1u);
+      for (std::size_t i = 0u; (i + 1u) < counts_.size(); i++)
+      {
+        if (counts_[i] == Count_t{0})
+        { continue; }
+
+        const bool lattice = (i < n_lattice);
+        const std::size_t rows = (lattice == true) ? (ny_ + 1u) : ny_;
+        const std::size_t j = (lattice == true) ? i : (i - n_lattice);
+        const double offset = (lattice == true) ? 0.0 : 0.5;
+        x.push_back(x_lo_ + (static_cast<double>(j/rows) + offset)*sx_);
+        y.push_back(y_lo_ + (static_cast<double>(j%rows) + offset)*sy_);
+        counts.push_back(counts_[i]);
+      }
+    }
+
+    Count_t outside() const noexcept
+    { return counts_.back(); }
+
+    std::array<double, 4> extent() const noexcept
+    { return {x_lo_, x_hi_, y_lo_, y_hi_}; }
+};
+
+/*
+  * histogram and histogram2d as containers, the counts are sent zero-copy
+*/
+template<typename Count_t>
+inline std::size_t container_size(const histogram<Count_t>& hist)
+{ return hist.n_bins(); }
+
+template<typename Count_t>
+inline std::array<std::size_t, 1> container_shape(const histogram<Count_t>& hist)
+{ return std::array<std::size_t, 1>{hist.n_bins()}; }
+
+template<typename Count_t>
+inline void fill_zmq_buffer(const histogram<Count_t>& hist, zmq::message_t& buffer)
+{
+  buffer.rebuild((void*)hist.counts(), sizeof(Count_t)*hist.n_bins(), custom_dealloc, zero_copy_tracker::track());
+}
+
+template<typename Count_t>
+inline std::size_t container_size(const histogram2d<Count_t>& heat)
+{ return heat.nx()*heat.ny(); }
+
+template<typename Count_t>
+inline std::array<std::size_t, 2> container_shape(const histogram2d<Count_t>& heat)
+{ return std::array<std::size_t, 2>{heat.ny(), heat.nx()}; }
+
+template<typename Count_t>
+inline void fill_zmq_buffer(const histogram2d<Count_t>& heat, zmq::message_t& buffer)
+{
+  buffer.rebuild((void*)heat.counts(), sizeof(Count_t)*heat.nx()*heat.ny(), custom_dealloc, zero_copy_tracker::track());
+}
+
+}
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef _CPPYPLOT_CONFLATE_H_
+#define _CPPYPLOT_CONFLATE_H_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <zmq.hpp>
+
+namespace Cppyplot
+{
+
+/*
+  * Latest-value slots for dashboards that only show the newest value of each variable.
+  * update(_p(x), ...) copies the values into one slot per name and returns, a sender thread
+  * evaluates the plot commands with the latest value of every slot at most once per period.
+  * Values overwritten before they were sent are dropped, so producers can update at any rate
+  * while the transport and the server see at most one plot per period.
+  * Thread-safe, the values passed to one update are always sent together.
+*/
+class conflator{
+  private:
+    struct slot_base{
+      std::string key;
+      bool dirty = false;   // updated since it was last sent
+      explicit slot_base(std::string name) : key(std::move(name)) {}
+      virtual ~slot_base() = default;
+      virtual void take() = 0;
+      virtual std::size_t send(cppyplot& pyp, zmq::socket_t& socket) = 0;
+    };
+
+    // double buffer, producers assign into latest, the sender swaps it with sending under the lock
+    template<typename T>
+    struct slot : slot_base{
+      T latest{}, sending{};
+      using slot_base::slot_base;
+
+      void take() override
+      {
+        using std::swap;
+        swap(latest, sending);
+      }
+
+      std::size_t send(cppyplot& pyp, zmq::socket_t& socket) override
+      { return pyp.send_container(socket, key, sending); }
+    };
+
+    cppyplot&    pyp_;
+    std::string  cmds_;
+    std::chrono::milliseconds period_;
+
+    std::mutex   mutex_;
+    std::condition_variable wake_;
+    std::vector<std::unique_ptr<slot_base>> slots_;
+    bool         pending_ = false;   // a slot changed since the last plot
+    bool         stop_    = false;
+    std::size_t  sent_    = 0u;
+    std::size_t  dropped_ = 0u;
+    std::exception_ptr error_;
+    std::thread  sender_;
+
+    template<typename T>
+    slot<T>& slot_of(const std::string& key)
+    {
+      for (auto& existing : slots_)
+      {
+        if (existing->key == key)
+        {
+          auto* typed = dynamic_cast<slot<T>*>(existing.get());
+          if (typed == nullptr)
+          { throw std::runtime_error("cppyplot: conflator slot '" + key + "' was created with another type"); }
+          return *typed;
+        }
+      }
+      slots_.push_back(std::make_unique<slot<T>>(key));
+      return static_cast<slot<T>&>(*slots_.back());
+    }
+
+    void run()
+    {
+      auto last_sent = std::chrono::steady_clock::now() - period_;
+      std::vector<slot_base*> sending;
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (true)
+      {
+        wake_.wait(lock, [this](){ return (pending_ == true) || (stop_ == true); });
+        if (pending_ == false)
+        { break; }
+
+        // updates arriving until the period is over overwrite the slots
+        (void)wake_.wait_until(lock, last_sent + period_, [this](){ return stop_; });
+
+        sending.clear();
+        for (auto& entry : slots_)
+        {
+          if (entry->dirty == true)
+          {
+            entry->take();
+            entry->dirty = false;
+          }
+          sending.push_back(entry.get());
+        }
+        pending_ = false;
+
+        // slots are never removed and the sending buffers are only touched by this thread, producers keep updating meanwhile
+        lock.unlock();
+        try
+        {
+          pyp_.send_parts(cmds_, [this, &sending](zmq::socket_t& socket)
+          {
+            std::size_t n_bytes = 0u;
+            for (slot_base* entry : sending)
+            { n_bytes += entry->send(pyp_, socket); }
+            return n_bytes;
+          });
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> error_lock(mutex_);
+          error_ = std::current_exception();
+        }
+        last_sent = std::chrono::steady_clock::now();
+        lock.lock();
+        sent_++;
+      }
+    }
+
+  public:
+    conflator(cppyplot& pyp, std::string_view cmds, std::chrono::milliseconds period = std::chrono::milliseconds{50})
+      : pyp_(pyp), cmds_(dedent_string(cmds)), period_(period)
+    { sender_ = std::thread(&conflator::run, this); }
+
+    conflator(const conflator& other) = delete;
+    conflator& operator=(const conflator& other) = delete;
+
+    // sends the latest values if they were not sent yet
+    ~conflator()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wake_.notify_one();
+      sender_.join();
+    }
+
+    // copy the values into their slots, e.g. dash.update(_p(speed), _p(rpm)). A name keeps the type of its first update.
+    // Throws the error of a failed send
+    template<typename... Val_t>
+    void update(std::pair<std::string, Val_t>&&... args)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_)
+        { std::rethrow_exception(std::exchange(error_, nullptr)); }
+        // slots first, a type mismatch leaves every slot untouched
+        std::array<slot_base*, sizeof...(Val_t)> targets{&slot_of<std::decay_t<Val_t>>(args.first)...};
+        std::size_t idx = 0u;
+        ((static_cast<slot<std::decay_t<Val_t>>&>(*targets[idx++]).latest = args.second), ...);
+
+        bool overwritten = false;
+        for (slot_base* target : targets)
+        {
+          overwritten = (overwritten == true) || (target->dirty == true);
+          target->dirty = true;
+        }
+        dropped_ += (overwritten == true) ? 1u : 0u;
+        pending_ = true;
+      }
+      wake_.notify_one();
+    }
+
+    // plots sent so far
+    std::size_t sent()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return sent_;
+    }
+
+    // updates overwritten before they were sent
+    std::size_t dropped()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return dropped_;
+    }
+};
+
+}
+
+#endif
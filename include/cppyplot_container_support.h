@@ -1,13 +1,94 @@
 #ifndef _CPPYPLOT_CONTAINER_SUPPORT_H_
 #define _CPPYPLOT_CONTAINER_SUPPORT_H_
 
+#include <array>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <zmq.hpp>
+
+// Eigen
+#if __has_include(<Eigen/Core>)
+  #include <Eigen/Core>
+  #define EIGEN_AVAILABLE
+#elif __has_include (<Eigen/Eigen/Core>)
+  #include <Eigen/Eigen/Core>
+  #define EIGEN_AVAILABLE
+#endif
+
+namespace Cppyplot
+{
+
+/*
+  * Zero-copy payloads point into user containers which must not change until zmq is done with them.
+  * A tracker counts the zero-copy payloads of the plot being sent from the current thread,
+  * zmq releases them through custom_dealloc and the sender waits for the count to drop to zero.
+*/
+class zero_copy_tracker{
+  private:
+    unsigned int            pending_ = 0u;
+    std::mutex              mutex_;
+    std::condition_variable released_;
+    zero_copy_tracker*      previous_;
+
+    static zero_copy_tracker*& active() noexcept
+    {
+      thread_local zero_copy_tracker* tracker = nullptr;
+      return tracker;
+    }
+  public:
+    zero_copy_tracker() : previous_(active())
+    { active() = this; }
+    zero_copy_tracker(zero_copy_tracker& other) = delete;
+    zero_copy_tracker operator=(zero_copy_tracker& other) = delete;
+    ~zero_copy_tracker()
+    {
+      wait();
+      active() = previous_;
+    }
+
+    // register one more zero-copy payload with the plot being sent, returns the hint for custom_dealloc
+    static void* track() noexcept
+    {
+      zero_copy_tracker* tracker = active();
+      if (tracker != nullptr)
+      {
+        std::lock_guard<std::mutex> lock(tracker->mutex_);
+        tracker->pending_++;
+      }
+      return tracker;
+    }
+
+    void release() noexcept
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_--;
+      if (pending_ == 0u)
+      { released_.notify_all(); }
+    }
+
+    void wait()
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      released_.wait(lock, [this](){ return pending_ == 0u; });
+    }
+};
 
 /* ZMQ requires custom dealloc function for zero-copy */
-void custom_dealloc(void* data, void* hint)
+inline void custom_dealloc(void* data, void* hint)
 {
   (void)data;
-  (void)hint; 
-  return; 
+  if (hint != nullptr)
+  { static_cast<zero_copy_tracker*>(hint)->release(); }
 }
 
 template<typename T>
@@ -22,6 +103,32 @@ struct is_string<std::string_view> : std::true_type {};
 template<typename T>
 inline constexpr bool is_string_v = is_string<T>::value;
 
+// memory order the server has to send data back in, 'C' row-major or 'F' column-major
+template<typename T, typename = void>
+struct storage_order { static constexpr char value = 'C'; };
+
+/*
+  * Helpers for receiving, 'recv_zmq_buffer' resizes the container to the shape sent back
+  * from the server and receives the payload directly into the container storage
+*/
+inline std::size_t shape_size(const std::vector<std::size_t>& shape) noexcept
+{ return std::accumulate(shape.begin(), shape.end(), std::size_t{1u}, std::multiplies<std::size_t>()); }
+
+inline void check_recv_size(std::size_t expected, std::size_t received)
+{
+  if (expected != received)
+  { 
+    throw std::length_error("cppyplot: size of the received data does not match the container, expected "
+                            + std::to_string(expected) + ", received " + std::to_string(received)); 
+  }
+}
+
+inline void recv_into(zmq::socket_t& socket, void* data, std::size_t n_bytes)
+{
+  auto result = socket.recv(zmq::mutable_buffer(data, n_bytes), zmq::recv_flags::none);
+  check_recv_size(n_bytes, result.has_value() ? result->untruncated_size : 0u);
+}
+
 /*
   * Integral and floating point datatypes
 */
@@ -42,6 +149,14 @@ inline auto fill_zmq_buffer(const T data, zmq::message_t& buffer)
   buffer.rebuild(&data, sizeof(T));
 }
 
+template<typename T>
+inline auto recv_zmq_buffer(zmq::socket_t& socket, T& data, const std::vector<std::size_t>& shape)
+        -> typename std::enable_if<std::is_arithmetic_v<T>, void>::type
+{
+  check_recv_size(1u, shape_size(shape));
+  recv_into(socket, &data, sizeof(T));
+}
+
 
 /*
   * std::string and std::string_view
@@ -60,7 +175,13 @@ template<typename T>
 inline auto fill_zmq_buffer(const T& data, zmq::message_t& buffer)
         -> typename std::enable_if<is_string_v<T>, void>::type
 {
-  buffer.rebuild((void*)data.data(), sizeof(typename T::value_type)*data.size(), custom_dealloc, nullptr);
+  buffer.rebuild((void*)data.data(), sizeof(typename T::value_type)*data.size(), custom_dealloc, zero_copy_tracker::track());
+}
+
+inline void recv_zmq_buffer(zmq::socket_t& socket, std::string& data, const std::vector<std::size_t>& shape)
+{
+  data.resize(shape_size(shape));
+  recv_into(socket, data.data(), data.size());
 }
 
 /*  
@@ -77,7 +198,14 @@ inline std::array<std::size_t,1> container_shape(const std::vector<T>& data)
 template<typename T>
 inline void fill_zmq_buffer(const std::vector<T>& data, zmq::message_t& buffer)
 {
-  buffer.rebuild((void*)data.data(), sizeof(T)*data.size(), custom_dealloc, nullptr);
+  buffer.rebuild((void*)data.data(), sizeof(T)*data.size(), custom_dealloc, zero_copy_tracker::track());
+}
+
+template<typename T>
+inline void recv_zmq_buffer(zmq::socket_t& socket, std::vector<T>& data, const std::vector<std::size_t>& shape)
+{
+  data.resize(shape_size(shape));
+  recv_into(socket, data.data(), sizeof(T)*data.size());
 }
 
 /*
@@ -94,7 +222,14 @@ inline std::array<std::size_t,1> container_shape(const std::array<T, N>& data)
 template<typename T, std::size_t N>
 inline void fill_zmq_buffer(const std::array<T, N>& data, zmq::message_t& buffer)
 {
-  buffer.rebuild((void*)data.data(), sizeof(T)*N, custom_dealloc, nullptr);
+  buffer.rebuild((void*)data.data(), sizeof(T)*N, custom_dealloc, zero_copy_tracker::track());
+}
+
+template<typename T, std::size_t N>
+inline void recv_zmq_buffer(zmq::socket_t& socket, std::array<T, N>& data, const std::vector<std::size_t>& shape)
+{
+  check_recv_size(N, shape_size(shape));
+  recv_into(socket, data.data(), sizeof(T)*N);
 }
 
 /*
@@ -108,19 +243,48 @@ template<typename T>
 inline std::array<std::size_t, 2> container_shape(const std::vector<std::vector<T>>& data)
 { return std::array<std::size_t, 2>{data.size(), data[0].size()}; }
 
-// this uses mempcpy, there will be a runtime overhead
+// rows are copied into one payload, data_args packs large ones on the packing_pool
+template<typename T>
+inline std::size_t packed_rows(const std::vector<std::vector<T>>& data)
+{ return data.size(); }
+
+template<typename T>
+inline void pack_rows(const std::vector<std::vector<T>>& data, char* dst, std::size_t begin, std::size_t end)
+{
+  const std::size_t n_cols = data[0].size();
+  for (std::size_t i = begin; i < end; i++)
+  {
+    if (data[i].size() != n_cols)
+    { throw std::length_error("cppyplot: rows of a 2D vector differ in length"); }
+    memcpy(dst + sizeof(T)*i*n_cols, data[i].data(), sizeof(T)*n_cols);
+  }
+}
+
 template<typename T>
 inline void fill_zmq_buffer(const std::vector<std::vector<T>>& data, zmq::message_t& buffer)
 {
   buffer.rebuild(sizeof(T)*data.size()*data[0].size());
-  char * ptr = static_cast<char*>(buffer.data());
+  pack_rows(data, static_cast<char*>(buffer.data()), 0u, data.size());
+}
+
+// rows are not stored in one continuous buffer, payload is received into a message and copied
+template<typename T>
+inline void recv_zmq_buffer(zmq::socket_t& socket, std::vector<std::vector<T>>& data, const std::vector<std::size_t>& shape)
+{
+  if (shape.size() != 2u)
+  { throw std::length_error("cppyplot: expected a 2D array to receive into a 2D vector"); }
+
+  zmq::message_t buffer;
+  (void)socket.recv(buffer, zmq::recv_flags::none);
+  check_recv_size(sizeof(T)*shape[0]*shape[1], buffer.size());
 
-  std::size_t offset = 0u;
-  for (std::size_t i = 0u; i < data.size(); i++)
+  const char * ptr = static_cast<const char*>(buffer.data());
+  std::size_t n_bytes = sizeof(T)*shape[1];
+  data.resize(shape[0]);
+  for (std::size_t i = 0u; i < shape[0]; i++)
   {
-    std::size_t n_bytes = sizeof(T)*data[i].size();
-    memcpy(ptr+offset, data[i].data(), n_bytes);
-    offset += n_bytes;
+    data[i].resize(shape[1]);
+    memcpy(data[i].data(), ptr + i*n_bytes, n_bytes);
   }
 }
 
@@ -135,22 +299,49 @@ template<typename T, std::size_t N, std::size_t M>
 inline std::array<std::size_t, 2> container_shape(const std::array<std::array<T, M>, N>& data)
 { (void)data; return std::array<std::size_t, 2>{N, M}; }
 
-// this uses mempcpy, there will be a runtime overhead
+template<typename T, std::size_t N, std::size_t M>
+inline std::size_t packed_rows(const std::array<std::array<T, M>, N>& data)
+{ (void)data; return N; }
+
+template<typename T, std::size_t N, std::size_t M>
+inline void pack_rows(const std::array<std::array<T, M>, N>& data, char* dst, std::size_t begin, std::size_t end)
+{
+  for (std::size_t i = begin; i < end; i++)
+  { memcpy(dst + sizeof(T)*i*M, data[i].data(), sizeof(T)*M); }
+}
+
 template<typename T, std::size_t N, std::size_t M>
 inline void fill_zmq_buffer(const std::array<std::array<T, M>, N>& data, zmq::message_t& buffer)
 {
   buffer.rebuild(sizeof(T)*N*M);
-  char * ptr = static_cast<char*>(buffer.data());
+  pack_rows(data, static_cast<char*>(buffer.data()), 0u, N);
+}
 
-  std::size_t offset = 0u;
-  size_t n_bytes = sizeof(T)*M;
-  for (std::size_t i = 0u; i < N; i++)
-  {
-    memcpy(ptr+offset, data[i].data(), n_bytes);
-    offset += n_bytes;
-  }
+template<typename T, std::size_t N, std::size_t M>
+inline void recv_zmq_buffer(zmq::socket_t& socket, std::array<std::array<T, M>, N>& data, const std::vector<std::size_t>& shape)
+{
+  // the rows are contiguous, the payload is received straight into them
+  static_assert(sizeof(data) == sizeof(T)*N*M, "nested std::array with padding between rows");
+  check_recv_size(N*M, shape_size(shape));
+  recv_into(socket, data.data(), sizeof(T)*N*M);
 }
 
+/*
+  * Memory-mapped files, only the path and the layout are sent and the server maps the file with np.memmap.
+  * The server has to see the same file system as the client.
+*/
+template<typename T>
+struct mapped_file{
+  using value_type = T;
+  std::string path;
+  std::vector<std::size_t> shape;  // empty maps everything after offset as a 1D array
+  std::size_t offset = 0u;         // in bytes
+  char        order = 'C';         // 'F' for column-major data
+
+  explicit mapped_file(std::string file_path, std::vector<std::size_t> file_shape = {}, std::size_t byte_offset = 0u, char memory_order = 'C')
+    : path(std::move(file_path)), shape(std::move(file_shape)), offset(byte_offset), order(memory_order)
+  {}
+};
 
 // Eigen Container support
 #if defined (EIGEN_AVAILABLE)
@@ -167,14 +358,81 @@ inline std::array<std::size_t, 2> container_shape(const Eigen::EigenBase<Derived
   return std::array<std::size_t, 2>{(std::size_t)eigen_container.rows(), (std::size_t)eigen_container.cols()};
 }
 
+// blocks and maps with gaps between their rows or columns are packed row by row, everything else is sent without a copy
+template<typename Derived>
+inline std::size_t packed_rows(const Eigen::EigenBase<Derived>& eigen_container)
+{
+  const Derived& data = eigen_container.derived();
+  const bool contiguous = (data.innerStride() == 1) && ((data.outerSize() <= 1) || (data.outerStride() == data.innerSize()));
+  return (contiguous == true) ? 0u : (std::size_t)data.rows();
+}
+
+template<typename Derived>
+inline void pack_rows(const Eigen::EigenBase<Derived>& eigen_container, char* dst, std::size_t begin, std::size_t end)
+{
+  using Scalar = typename Derived::Scalar;
+  const Derived& data = eigen_container.derived();
+  Scalar* out = reinterpret_cast<Scalar*>(dst) + begin*(std::size_t)data.cols();
+  for (std::size_t r = begin; r < end; r++)
+  {
+    for (Eigen::Index c = 0; c < data.cols(); c++)
+    { *out++ = data.coeff((Eigen::Index)r, c); }
+  }
+}
+
 template<typename Derived>
 inline void fill_zmq_buffer(const Eigen::EigenBase<Derived>& eigen_container, zmq::message_t& buffer)
 {
   auto elem_size = sizeof(typename Derived::value_type);
-  buffer.rebuild((void*)eigen_container.derived().data(), elem_size*eigen_container.size(), 
-                 custom_dealloc, nullptr);
+  const std::size_t n_rows = packed_rows(eigen_container);
+  if (n_rows == 0u)
+  {
+    buffer.rebuild((void*)eigen_container.derived().data(), elem_size*eigen_container.size(), 
+                   custom_dealloc, zero_copy_tracker::track());
+    return;
+  }
+  buffer.rebuild(elem_size*eigen_container.size());
+  pack_rows(eigen_container, static_cast<char*>(buffer.data()), 0u, n_rows);
+}
+
+template<typename Derived>
+struct storage_order<Derived, std::enable_if_t<std::is_base_of_v<Eigen::EigenBase<Derived>, Derived>>>
+{ static constexpr char value = Derived::IsRowMajor ? 'C' : 'F'; };
+
+template<typename Derived>
+inline void recv_zmq_buffer(zmq::socket_t& socket, Eigen::PlainObjectBase<Derived>& eigen_container, 
+                            const std::vector<std::size_t>& shape)
+{
+  std::size_t rows = (shape.size() > 0u) ? shape[0] : 1u;
+  std::size_t cols = (shape.size() > 1u) ? shape[1] : 1u;
+  // 1D arrays fill a row vector along its columns
+  if ((shape.size() == 1u) && (Derived::RowsAtCompileTime == 1))
+  { std::swap(rows, cols); }
+  if (   ((Derived::RowsAtCompileTime != Eigen::Dynamic) && (rows != (std::size_t)Derived::RowsAtCompileTime))
+      || ((Derived::ColsAtCompileTime != Eigen::Dynamic) && (cols != (std::size_t)Derived::ColsAtCompileTime)))
+  { throw std::length_error("cppyplot: received shape does not fit the fixed size Eigen container"); }
+
+  eigen_container.resize(rows, cols);
+  recv_into(socket, eigen_container.data(), sizeof(typename Derived::Scalar)*eigen_container.size());
 }
 
 #endif
 
+// memory order of the payload fill_zmq_buffer sends, 'F' for contiguous column-major Eigen matrices sent without a copy
+template<typename T>
+inline char payload_order(const T& cont) noexcept
+{
+#if defined (EIGEN_AVAILABLE)
+  if constexpr (std::is_base_of_v<Eigen::EigenBase<T>, T>)
+  {
+    const bool column_major = (T::IsRowMajor == false) && (cont.rows() > 1) && (cont.cols() > 1);
+    return ((column_major == true) && (packed_rows(cont) == 0u)) ? 'F' : 'C';
+  }
+#endif
+  (void)cont;
+  return 'C';
+}
+
+}
+
 #endif
@@ -0,0 +1,153 @@
+#### command line arguments ####
+from argparse import ArgumentParser
+cmd_parser = ArgumentParser(description="Keeps cppyplot servers with their libraries imported, ready to be handed out to cppyplot clients")
+cmd_parser.add_argument("endpoint", nargs="?", default="ipc:///tmp/cppyplot_daemon", help="address clients request a server from")
+cmd_parser.add_argument("--pool", type=int, default=2, help="number of warm servers kept ready")
+cmd_parser.add_argument("--preload", type=str, default="", help="comma separated modules imported in addition to numpy and matplotlib, e.g. seaborn,pandas")
+cmd_args = cmd_parser.parse_args()
+
+import os
+import sys
+import json
+import signal
+import runpy
+import importlib
+from collections import deque, OrderedDict
+
+SERVER_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "cppyplot_server.py")
+
+#### warm up ####
+# the expensive part of a server start, done once here and shared with every forked server
+import numpy
+import matplotlib
+import matplotlib.pyplot
+import matplotlib.cm
+import zmq
+import asteval
+for module in filter(None, cmd_args.preload.split(",")):
+    importlib.import_module(module.strip())
+
+#### warm servers ####
+def fork_warm_server()->tuple:
+    # the child waits for its command line on a pipe, then runs cppyplot_server.py in place
+    assign_read, assign_write = os.pipe()
+    pid = os.fork()
+    if (pid != 0):
+        os.close(assign_read)
+        return (pid, assign_write)
+
+    os.close(assign_write)
+    signal.signal(signal.SIGCHLD, signal.SIG_DFL)
+    signal.signal(signal.SIGINT, signal.SIG_DFL)
+    # do not keep the daemon socket and the pipes of the other warm servers open
+    os.closerange(3, assign_read)
+    os.closerange(assign_read + 1, os.sysconf("SC_OPEN_MAX"))
+    with os.fdopen(assign_read, "rb") as assignment:
+        request = assignment.read()
+    if (not request):
+        os._exit(0) # daemon shut down
+
+    # handed out servers outlive the daemon, and run relative to the client
+    os.setsid()
+    request = json.loads(request)
+    os.chdir(request["cwd"])
+    sys.argv = [SERVER_PATH] + request["args"]
+    exit_code = 0
+    try:
+        runpy.run_path(SERVER_PATH, run_name="__main__")
+    except SystemExit as exit_request:
+        exit_code = exit_request.code if isinstance(exit_request.code, int) else 0
+    except BaseException:
+        import traceback
+        traceback.print_exc()
+        exit_code = 1
+    finally:
+        sys.stdout.flush()
+        sys.stderr.flush()
+    os._exit(exit_code)
+
+def hand_out(warm:deque, request:dict)->int:
+    payload = json.dumps(request).encode()
+    while warm:
+        pid, assign_write = warm.popleft()
+        try:
+            os.write(assign_write, payload)
+            return pid
+        except OSError:
+            pass # this warm server died meanwhile, try the next one
+        finally:
+            os.close(assign_write)
+    raise RuntimeError("no warm server available")
+
+# tokens of the last requests, clients cancel a request they stopped waiting for
+MAX_TOKENS = 256
+handed_out = OrderedDict()
+cancelled  = OrderedDict()
+
+def remember(tokens:OrderedDict, token:bytes, value)->None:
+    tokens[token] = value
+    while (len(tokens) > MAX_TOKENS):
+        tokens.popitem(last=False)
+
+def cancel(token:bytes)->None:
+    pid = handed_out.pop(token, None)
+    if (pid is None):
+        # the cancel overtook its spawn request
+        remember(cancelled, token, True)
+        return
+    try:
+        # handed out servers lead their own process group, their render workers go with them
+        os.killpg(pid, signal.SIGKILL)
+    except ProcessLookupError:
+        # not yet the leader of its group, it has no workers either
+        try:
+            os.kill(pid, signal.SIGKILL)
+        except ProcessLookupError:
+            return
+    print(f"[INFO] killed server {pid}, its client gave up waiting")
+
+#### main ####
+if __name__ == '__main__':
+    # handed out servers are reaped automatically
+    signal.signal(signal.SIGCHLD, signal.SIG_IGN)
+    warm = deque(fork_warm_server() for _ in range(max(cmd_args.pool, 1)))
+
+    context = zmq.Context()
+    socket = context.socket(zmq.REP)
+    socket.setsockopt(zmq.LINGER, 0)
+    socket.bind(cmd_args.endpoint)
+    print(f"[INFO] cppyplot daemon listening on {cmd_args.endpoint} with {len(warm)} warm servers")
+
+    try:
+        while True:
+            # spawn|<token>|<client cwd>|<server arguments>..., cancel|<token> or ping
+            request = socket.recv_multipart()
+            if (request[0] == b"ping"):
+                socket.send_multipart([b"ok", str(len(warm)).encode()])
+            elif ((request[0] == b"cancel") and (len(request) == 2)):
+                cancel(request[1])
+                socket.send_multipart([b"ok", b""])
+            elif ((request[0] == b"spawn") and (len(request) >= 3)):
+                try:
+                    if (cancelled.pop(request[1], None) is not None):
+                        raise RuntimeError("request was cancelled")
+                    if (not warm):
+                        warm.append(fork_warm_server())
+                    pid = hand_out(warm, {"cwd": request[2].decode(), "args": [arg.decode() for arg in request[3:]]})
+                    remember(handed_out, request[1], pid)
+                    socket.send_multipart([b"ok", str(pid).encode()])
+                    print(f"[INFO] handed out server {pid}")
+                except Exception as err:
+                    socket.send_multipart([b"error", str(err).encode()])
+                while (len(warm) < max(cmd_args.pool, 1)):
+                    warm.append(fork_warm_server())
+            else:
+                socket.send_multipart([b"error", b"unknown request"])
+    except KeyboardInterrupt:
+        print("[INFO] cppyplot daemon shutting down")
+    finally:
+        # warm servers read an empty request and exit
+        for _, assign_write in warm:
+            os.close(assign_write)
+        socket.close()
+        context.term()
@@ -0,0 +1,1246 @@
+#ifndef _CPPYPLOT_IMPL_H_
+#define _CPPYPLOT_IMPL_H_
+
+/*
+  * Non-template parts of cppyplot.hpp: transport, sessions and string utilities.
+  * Included at the end of cppyplot.hpp, or compiled once into the cppyplot_transport
+  * library when CPPYPLOT_COMPILED_LIB is defined (see src/cppyplot.cpp).
+*/
+
+#include "cppyplot.hpp"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+  #include <cerrno>
+  #include <csignal>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <spawn.h>
+  #include <sys/wait.h>
+  #include <unistd.h>
+  extern char **environ;
+#else
+  #include <process.h>
+#endif
+
+namespace Cppyplot
+{
+
+// server_process
+#if !defined(_WIN32) && !defined(_WIN64)
+// both ends are close-on-exec and above the standard descriptors, so the dup2 into the child always applies
+CPPYPLOT_INLINE void open_cloexec_pipe(int (&fds)[2])
+{
+  int raw[2];
+  if (::pipe(raw) != 0)
+  { throw std::system_error(errno, std::generic_category(), "cppyplot: could not create a pipe for the server"); }
+  for (int i = 0; i < 2; i++)
+  {
+    fds[i] = ::fcntl(raw[i], F_DUPFD_CLOEXEC, 10);
+    ::close(raw[i]);
+  }
+  if ((fds[0] < 0) || (fds[1] < 0))
+  {
+    int err = errno;
+    for (int fd : fds)
+    { if (fd >= 0) { ::close(fd); } }
+    throw std::system_error(err, std::generic_category(), "cppyplot: could not create a pipe for the server");
+  }
+}
+
+CPPYPLOT_INLINE void server_process::spawn(const std::vector<std::string>& args)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  close_pipes_locked();
+
+  int output[2];
+  int heartbeat[2];
+  open_cloexec_pipe(output);
+  try
+  { open_cloexec_pipe(heartbeat); }
+  catch (...)
+  { ::close(output[0]); ::close(output[1]); throw; }
+
+  posix_spawn_file_actions_t actions;
+  ::posix_spawn_file_actions_init(&actions);
+  ::posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+  ::posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+  ::posix_spawn_file_actions_adddup2(&actions, output[1], STDERR_FILENO);
+  ::posix_spawn_file_actions_adddup2(&actions, heartbeat[1], server_process::heartbeat_fd);
+
+  std::vector<char*> argv;
+  for (const auto& arg : args)
+  { argv.push_back(const_cast<char*>(arg.c_str())); }
+  argv.push_back(nullptr);
+
+  pid_t pid = -1;
+  int err = ::posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+  ::posix_spawn_file_actions_destroy(&actions);
+  ::close(output[1]);
+  ::close(heartbeat[1]);
+  if (err != 0)
+  {
+    ::close(output[0]);
+    ::close(heartbeat[0]);
+    throw std::system_error(err, std::generic_category(), "cppyplot: could not spawn '"s + args[0] + "'"s);
+  }
+
+  ::fcntl(output[0],    F_SETFL, ::fcntl(output[0],    F_GETFL) | O_NONBLOCK);
+  ::fcntl(heartbeat[0], F_SETFL, ::fcntl(heartbeat[0], F_GETFL) | O_NONBLOCK);
+  pid_          = pid;
+  exited_       = false;
+  adopted_      = false;
+  status_       = 0;
+  output_fd_    = output[0];
+  heartbeat_fd_ = heartbeat[0];
+  partial_line_.clear();
+}
+
+CPPYPLOT_INLINE void server_process::adopt(long pid)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  close_pipes_locked();
+  pid_     = static_cast<pid_t>(pid);
+  exited_  = false;
+  adopted_ = true;
+  status_  = 0;
+  partial_line_.clear();
+}
+
+CPPYPLOT_INLINE bool server_process::reap_locked()
+{
+  if ((pid_ <= 0) || (exited_ == true))
+  { return true; }
+
+  // not a child of this process, it is reaped by its parent
+  if (adopted_ == true)
+  {
+    if ((::kill(pid_, 0) != 0) && (errno == ESRCH))
+    { exited_ = true; }
+    return exited_;
+  }
+
+  int status = 0;
+  pid_t result = ::waitpid(pid_, &status, WNOHANG);
+  if (result == pid_)
+  { exited_ = true; status_ = status; }
+  else if ((result < 0) && (errno != EINTR))
+  { exited_ = true; } // reaped elsewhere, e.g. SIGCHLD is ignored
+  return exited_;
+}
+
+CPPYPLOT_INLINE void server_process::close_pipes_locked() noexcept
+{
+  for (int* fd : {&output_fd_, &heartbeat_fd_})
+  {
+    if (*fd >= 0)
+    { ::close(*fd); *fd = -1; }
+  }
+}
+
+CPPYPLOT_INLINE bool server_process::running()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return (pid_ > 0) && (reap_locked() == false);
+}
+
+CPPYPLOT_INLINE bool server_process::wait_exit(std::chrono::milliseconds timeout)
+{
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (running() == true)
+  {
+    if (std::chrono::steady_clock::now() >= deadline)
+    { return false; }
+    std::this_thread::sleep_for(10ms);
+  }
+  return true;
+}
+
+CPPYPLOT_INLINE void server_process::terminate()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if ((pid_ > 0) && (exited_ == false))
+  { ::kill(pid_, SIGTERM); }
+}
+
+CPPYPLOT_INLINE void server_process::kill()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if ((pid_ > 0) && (exited_ == false))
+  { ::kill(pid_, SIGKILL); }
+}
+
+CPPYPLOT_INLINE void server_process::release() noexcept
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  close_pipes_locked();
+  pid_     = -1;
+  exited_  = false;
+  adopted_ = false;
+}
+
+CPPYPLOT_INLINE bool server_process::supervised() const noexcept
+{ return true; }
+
+CPPYPLOT_INLINE bool server_process::has_heartbeat() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return (adopted_ == false) && (pid_ > 0);
+}
+
+CPPYPLOT_INLINE std::size_t server_process::poll_events(std::chrono::milliseconds timeout, const std::function<void(std::string_view)>& on_line)
+{
+  pollfd items[2];
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    items[0] = {output_fd_,    POLLIN, 0};
+    items[1] = {heartbeat_fd_, POLLIN, 0};
+  }
+  if (::poll(items, 2, static_cast<int>(timeout.count())) <= 0)
+  { return 0u; }
+
+  std::array<char, 4096> chunk;
+  std::size_t n_heartbeats = 0u;
+  bool output_closed = false;
+  bool heartbeat_closed = false;
+  ssize_t n_read = 0;
+  if (items[0].revents != 0)
+  {
+    while ((n_read = ::read(items[0].fd, chunk.data(), chunk.size())) > 0)
+    { partial_line_.append(chunk.data(), static_cast<std::size_t>(n_read)); }
+    output_closed = (n_read == 0);
+  }
+  if (items[1].revents != 0)
+  {
+    while ((n_read = ::read(items[1].fd, chunk.data(), chunk.size())) > 0)
+    { n_heartbeats += static_cast<std::size_t>(n_read); }
+    heartbeat_closed = (n_read == 0);
+  }
+
+  std::size_t line_start = 0u;
+  for (std::size_t line_end = partial_line_.find('\n'); line_end != std::string::npos; line_end = partial_line_.find('\n', line_start))
+  {
+    std::string_view line(partial_line_.data() + line_start, line_end - line_start);
+    if ((line.empty() == false) && (line.back() == '\r'))
+    { line.remove_suffix(1u); }
+    on_line(line);
+    line_start = line_end + 1u;
+  }
+  partial_line_.erase(0u, line_start);
+  if ((output_closed == true) && (partial_line_.empty() == false))
+  { on_line(partial_line_); partial_line_.clear(); }
+
+  // closed once the server and every process it forked exited
+  if ((output_closed == true) || (heartbeat_closed == true))
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ((output_closed == true) && (output_fd_ >= 0))
+    { ::close(output_fd_); output_fd_ = -1; }
+    if ((heartbeat_closed == true) && (heartbeat_fd_ >= 0))
+    { ::close(heartbeat_fd_); heartbeat_fd_ = -1; }
+  }
+  return n_heartbeats;
+}
+
+CPPYPLOT_INLINE std::string server_process::status_str() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pid_ <= 0)
+  { return "is not running"s; }
+  if (exited_ == false)
+  { return "is running"s; }
+  if (adopted_ == true)
+  { return "exited"s; }
+  if (WIFEXITED(status_))
+  { return "exited with code "s + std::to_string(WEXITSTATUS(status_)); }
+  if (WIFSIGNALED(status_))
+  { return "was killed by signal "s + std::to_string(WTERMSIG(status_)); }
+  return "exited"s;
+}
+#else
+CPPYPLOT_INLINE void server_process::spawn(const std::vector<std::string>& args)
+{
+  std::string command{"start /min "};
+  for (const auto& arg : args)
+  { command += arg; command += " "s; }
+  std::system(command.c_str());
+  std::lock_guard<std::mutex> lock(mutex_);
+  started_ = true;
+}
+
+CPPYPLOT_INLINE void server_process::adopt(long pid)
+{
+  (void)pid;
+  std::lock_guard<std::mutex> lock(mutex_);
+  started_ = true;
+}
+
+CPPYPLOT_INLINE bool server_process::running()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return started_;
+}
+
+CPPYPLOT_INLINE bool server_process::wait_exit(std::chrono::milliseconds timeout)
+{ (void)timeout; return (running() == false); }
+
+CPPYPLOT_INLINE void server_process::terminate()
+{ }
+
+CPPYPLOT_INLINE void server_process::kill()
+{ }
+
+CPPYPLOT_INLINE void server_process::release() noexcept
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  started_ = false;
+}
+
+CPPYPLOT_INLINE bool server_process::supervised() const noexcept
+{ return false; }
+
+CPPYPLOT_INLINE bool server_process::has_heartbeat() const
+{ return false; }
+
+CPPYPLOT_INLINE std::size_t server_process::poll_events(std::chrono::milliseconds timeout, const std::function<void(std::string_view)>& on_line)
+{
+  (void)on_line;
+  std::this_thread::sleep_for(timeout);
+  return 0u;
+}
+
+CPPYPLOT_INLINE std::string server_process::status_str() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return started_ ? "was started without supervision"s : "is not running"s;
+}
+#endif
+
+// data_providers
+CPPYPLOT_INLINE std::uint64_t data_providers::add(handler_t handler)
+{
+  std::lock_guard<std::mutex> lock(data_providers::mutex_);
+  const std::uint64_t id = data_providers::next_id_++;
+  data_providers::handlers_.emplace(id, std::move(handler));
+  return id;
+}
+
+CPPYPLOT_INLINE void data_providers::remove(std::uint64_t id) noexcept
+{
+  std::lock_guard<std::mutex> lock(data_providers::mutex_);
+  data_providers::handlers_.erase(id);
+}
+
+CPPYPLOT_INLINE void data_providers::serve(zmq::socket_t& socket)
+{
+  zmq::message_t request;
+  if (socket.recv(request, zmq::recv_flags::dontwait).has_value() == false)
+  { return; }
+
+  // <id>|<arguments>...
+  std::vector<std::string> args;
+  std::string_view rest = request.to_string_view();
+  while (true)
+  {
+    const std::size_t end = rest.find('|');
+    args.emplace_back(rest.substr(0u, end));
+    if (end == std::string_view::npos)
+    { break; }
+    rest.remove_prefix(end + 1u);
+  }
+
+  std::vector<zmq::message_t> reply;
+  try
+  {
+    std::lock_guard<std::mutex> lock(data_providers::mutex_);
+    const std::uint64_t id = std::stoull(args[0]);
+    auto handler = data_providers::handlers_.find(id);
+    if (handler == data_providers::handlers_.end())
+    { throw std::runtime_error("no data provider "s + args[0] + ", it was destroyed"s); }
+    args.erase(args.begin());
+    handler->second(args, reply);
+  }
+  catch (const std::exception& err)
+  {
+    reply.clear();
+    reply.emplace_back("error|"s + err.what());
+  }
+
+  for (std::size_t i = 0u; i < reply.size(); i++)
+  { socket.send(reply[i], ((i + 1u) < reply.size()) ? zmq::send_flags::sndmore : zmq::send_flags::none); }
+
+  std::vector<std::function<void()>> deferred;
+  deferred.swap(data_providers::deferred_);
+  for (auto& work : deferred)
+  {
+    // the request was answered already, there is no one to report a failure to
+    try
+    { work(); }
+    catch (...)
+    { }
+  }
+}
+
+CPPYPLOT_INLINE void data_providers::defer(std::function<void()> work)
+{ data_providers::deferred_.push_back(std::move(work)); }
+
+// animation_export
+CPPYPLOT_INLINE animation_export::animation_export(std::function<void(const animation_export&)> on_finish)
+  : on_finish_(std::move(on_finish))
+{
+  provider_id_ = data_providers::add([this](const std::vector<std::string>& args, std::vector<zmq::message_t>& reply)
+  { notify(args, reply); });
+}
+
+CPPYPLOT_INLINE animation_export::~animation_export()
+{
+  data_providers::remove(provider_id_);
+
+  // on_finish may still be running on the forwarder thread
+  std::unique_lock<std::mutex> lock(mutex_);
+  finished_.wait(lock, [this](){ return finishing_ == false; });
+}
+
+CPPYPLOT_INLINE animation_export::status animation_export::state() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return state_;
+}
+
+CPPYPLOT_INLINE animation_export::status animation_export::wait_for(std::chrono::milliseconds timeout) const
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  finished_.wait_for(lock, timeout, [this](){ return state_ != status::pending; });
+  return state_;
+}
+
+CPPYPLOT_INLINE animation_export::status animation_export::wait() const
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  finished_.wait(lock, [this](){ return state_ != status::pending; });
+  return state_;
+}
+
+CPPYPLOT_INLINE std::string animation_export::path() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return path_;
+}
+
+CPPYPLOT_INLINE std::size_t animation_export::frames() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frames_;
+}
+
+CPPYPLOT_INLINE double animation_export::seconds() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return seconds_;
+}
+
+CPPYPLOT_INLINE std::string animation_export::error() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return error_;
+}
+
+CPPYPLOT_INLINE void animation_export::notify(const std::vector<std::string>& args, std::vector<zmq::message_t>& reply)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ((args.size() == 4u) && (args[0] == "done"))
+    {
+      path_    = args[1];
+      frames_  = static_cast<std::size_t>(std::stoull(args[2]));
+      seconds_ = std::stod(args[3]);
+      state_   = status::done;
+    }
+    else if ((args.size() >= 2u) && (args[0] == "failed"))
+    {
+      // the message may contain '|'
+      error_ = args[1];
+      for (std::size_t i = 2u; i < args.size(); i++)
+      { error_ += "|"s + args[i]; }
+      state_ = status::failed;
+    }
+    else
+    { throw std::runtime_error("malformed animation export notification"); }
+    finishing_ = static_cast<bool>(on_finish_);
+  }
+  finished_.notify_all();
+  reply.emplace_back("ok"s);
+
+  // after the reply, the server's encoder does not wait for on_finish and it may use data providers
+  if (on_finish_)
+  {
+    data_providers::defer([this]()
+    {
+      try
+      { on_finish_(*this); }
+      catch (...)
+      { }
+      std::lock_guard<std::mutex> lock(mutex_);
+      finishing_ = false;
+      finished_.notify_all();
+    });
+  }
+}
+
+// packing_pool
+CPPYPLOT_INLINE packing_pool::workers_t::~workers_t()
+{
+  {
+    std::lock_guard<std::mutex> lock(packing_pool::mutex_);
+    packing_pool::stop_ = true;
+  }
+  packing_pool::wake_.notify_all();
+  for (auto& worker : threads)
+  { worker.join(); }
+}
+
+CPPYPLOT_INLINE void packing_pool::set_threads(std::size_t n_threads) noexcept
+{ packing_pool::n_threads_ = n_threads; }
+
+CPPYPLOT_INLINE std::size_t packing_pool::threads() noexcept
+{
+  const std::size_t n_threads = packing_pool::n_threads_;
+  return (n_threads != 0u) ? n_threads : std::max<std::size_t>(std::thread::hardware_concurrency(), 1u);
+}
+
+CPPYPLOT_INLINE void packing_pool::drain(std::vector<task_t>& tasks) noexcept
+{
+  for (std::size_t i = packing_pool::next_task_++; i < tasks.size(); i = packing_pool::next_task_++)
+  {
+    try
+    { tasks[i](); }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(packing_pool::mutex_);
+      if (!packing_pool::error_)
+      { packing_pool::error_ = std::current_exception(); }
+    }
+  }
+}
+
+// seen is the last run started before the worker
+CPPYPLOT_INLINE void packing_pool::work(std::size_t seen)
+{
+  std::unique_lock<std::mutex> lock(packing_pool::mutex_);
+  while (true)
+  {
+    packing_pool::wake_.wait(lock, [&seen](){ return (packing_pool::stop_ == true) || (packing_pool::generation_ != seen); });
+    if (packing_pool::stop_ == true)
+    { break; }
+    seen = packing_pool::generation_;
+
+    std::vector<task_t>* tasks = packing_pool::tasks_;
+    lock.unlock();
+    packing_pool::drain(*tasks);
+    lock.lock();
+
+    packing_pool::busy_--;
+    if (packing_pool::busy_ == 0u)
+    { packing_pool::done_.notify_all(); }
+  }
+}
+
+// called with run_mutex_ held, so no run is in progress
+CPPYPLOT_INLINE void packing_pool::resize_locked(std::size_t n_workers)
+{
+  std::vector<std::thread>& threads = packing_pool::workers_.threads;
+  if (threads.size() == n_workers)
+  { return; }
+
+  {
+    std::lock_guard<std::mutex> lock(packing_pool::mutex_);
+    packing_pool::stop_ = true;
+  }
+  packing_pool::wake_.notify_all();
+  for (auto& worker : threads)
+  { worker.join(); }
+  threads.clear();
+
+  std::lock_guard<std::mutex> lock(packing_pool::mutex_);
+  packing_pool::stop_ = false;
+  for (std::size_t i = 0u; i < n_workers; i++)
+  { threads.emplace_back(&packing_pool::work, packing_pool::generation_); }
+}
+
+CPPYPLOT_INLINE void packing_pool::run(std::vector<task_t>& tasks)
+{
+  std::unique_lock<std::mutex> run_lock(packing_pool::run_mutex_, std::try_to_lock);
+  if ((run_lock.owns_lock() == false) || (tasks.size() <= 1u) || (packing_pool::threads() <= 1u))
+  {
+    for (auto& task : tasks)
+    { task(); }
+    return;
+  }
+
+  packing_pool::resize_locked(packing_pool::threads() - 1u);
+  {
+    std::lock_guard<std::mutex> lock(packing_pool::mutex_);
+    packing_pool::tasks_ = &tasks;
+    packing_pool::next_task_ = 0u;
+    packing_pool::busy_ = packing_pool::workers_.threads.size();
+    packing_pool::error_ = nullptr;
+    packing_pool::generation_++;
+  }
+  packing_pool::wake_.notify_all();
+  packing_pool::drain(tasks);
+
+  std::unique_lock<std::mutex> lock(packing_pool::mutex_);
+  packing_pool::done_.wait(lock, [](){ return packing_pool::busy_ == 0u; });
+  packing_pool::tasks_ = nullptr;
+  if (packing_pool::error_)
+  { std::rethrow_exception(std::exchange(packing_pool::error_, nullptr)); }
+}
+
+// session
+CPPYPLOT_INLINE void session::record_published(const zmq::message_t& final_msg) noexcept
+{
+  // last parts are also chunk payloads of many MB, only finalize parts are searched for the time
+  std::string_view final_str = final_msg.to_string_view();
+  if (final_str.substr(0u, 9u) != "finalize|")
+  { return; }
+  std::size_t time_pos = final_str.rfind('|');
+
+  std::uint64_t submit_ns = 0u;
+  for (char c : final_str.substr(time_pos + 1u))
+  { submit_ns = submit_ns*10u + static_cast<std::uint64_t>(c - '0'); }
+  std::uint64_t now_ns = to_wire_time(frame_clock::now());
+  publish_latency_.record((now_ns > submit_ns) ? (now_ns - submit_ns) : 0u);
+  frames_published_.fetch_add(1u, std::memory_order_relaxed);
+}
+
+CPPYPLOT_INLINE void session::set_subscribed(bool subscribed)
+{
+  {
+    std::lock_guard<std::mutex> lock(ready_mutex_);
+    subscribed_ = subscribed;
+  }
+  ready_cv_.notify_all();
+}
+
+CPPYPLOT_INLINE void session::forward()
+{
+  zmq::message_t msg;
+  zmq::pollitem_t items[] = {{fan_in_.handle(), 0, ZMQ_POLLIN, 0}, {socket_.handle(), 0, ZMQ_POLLIN, 0},
+                             {service_.handle(), 0, ZMQ_POLLIN, 0}};
+  while (true)
+  {
+    zmq::poll(items, 3, 50ms);
+
+    if ((items[2].revents & ZMQ_POLLIN) != 0)
+    { data_providers::serve(service_); }
+
+    // the publisher reports the server subscribing (1) and disconnecting (0)
+    if ((items[1].revents & ZMQ_POLLIN) != 0)
+    {
+      (void)socket_.recv(msg, zmq::recv_flags::none);
+      if (msg.size() > 0u)
+      { set_subscribed(msg.data<std::uint8_t>()[0] == 1u); }
+    }
+
+    if ((items[0].revents & ZMQ_POLLIN) == 0)
+    {
+      // exit only once the pipe is drained
+      if (stop_forwarder_.load() == true)
+      { break; }
+      continue;
+    }
+
+    bool more = true;
+    while (more == true)
+    {
+      (void)fan_in_.recv(msg, zmq::recv_flags::none);
+      more = msg.more();
+      if (more == false)
+      { record_published(msg); }
+      socket_.send(msg, more ? zmq::send_flags::sndmore : zmq::send_flags::none);
+    }
+  }
+}
+
+CPPYPLOT_INLINE std::vector<std::string> session::server_args() const
+{
+  std::vector<std::string> args{zmq_ip_addr_, "--reply_addr"s, reply_addr_, "--service_addr"s, service_addr_};
+  if (options_.headless == true)
+  { args.insert(args.end(), {"--headless"s, "--workers"s, std::to_string(options_.n_render_workers)}); }
+  if (options_.n_export_workers > 0u)
+  { args.insert(args.end(), {"--export_workers"s, std::to_string(options_.n_export_workers)}); }
+  args.insert(args.end(), {"--stats_interval"s, std::to_string(options_.stats_interval.count())});
+  for (const auto& library : options_.libraries)
+  { args.insert(args.end(), {"--lib"s, library}); }
+
+  // a few heartbeats per timeout, the server also uses them to notice this process is gone
+  auto interval = (options_.heartbeat_timeout.count() > 0) ? options_.heartbeat_timeout/5 : std::chrono::milliseconds(1000);
+  interval = std::max(interval, std::chrono::milliseconds(50));
+  args.insert(args.end(), {"--heartbeat_interval"s, std::to_string(static_cast<double>(interval.count())*1.0e-3)});
+  return args;
+}
+
+CPPYPLOT_INLINE bool session::request_warm_server(const std::string& daemon_addr)
+{
+  zmq::socket_t request(session::context_, ZMQ_REQ);
+  request.set(zmq::sockopt::linger, 0);
+  request.connect(daemon_addr);
+
+#if defined(_WIN32) || defined(_WIN64)
+  const long client_pid = static_cast<long>(::_getpid());
+#else
+  const long client_pid = static_cast<long>(::getpid());
+#endif
+  // spawn|<token>|<working directory>|<server arguments>..., the token names this request to cancel it
+  static std::atomic<std::uint64_t> n_requests{0u};
+  const std::string token = std::to_string(client_pid) + "-"s + std::to_string(id_) + "-"s + std::to_string(n_requests.fetch_add(1u));
+  std::vector<std::string> parts{"spawn"s, token, std::filesystem::current_path().string()};
+  for (auto& arg : server_args())
+  { parts.push_back(std::move(arg)); }
+  parts.insert(parts.end(), {"--client_pid"s, std::to_string(client_pid)});
+  for (std::size_t i = 0u; i < parts.size(); i++)
+  {
+    zmq::message_t part(parts[i].data(), parts[i].size());
+    (void)request.send(part, ((i + 1u) < parts.size()) ? zmq::send_flags::sndmore : zmq::send_flags::none);
+  }
+
+  // a daemon that is not running must not hold up the first plot for long. One that answers too late
+  // still hands out a server, it is cancelled so that it does not render every plot next to the spawned one
+  zmq::pollitem_t items[] = {{request.handle(), 0, ZMQ_POLLIN, 0}};
+  if (zmq::poll(items, 1, options_.daemon_timeout) == 0)
+  {
+    log_server("[cppyplot] no answer from the server daemon on "s + daemon_addr + ", spawning a server"s);
+    zmq::socket_t cancel(session::context_, ZMQ_REQ);
+    // the daemon is local, a running one takes the message within the linger period even while it is busy
+    cancel.set(zmq::sockopt::linger, 100);
+    cancel.connect(daemon_addr);
+    zmq::message_t cancel_cmd("cancel", 6);
+    zmq::message_t cancel_token(token.data(), token.size());
+    (void)cancel.send(cancel_cmd, zmq::send_flags::sndmore);
+    (void)cancel.send(cancel_token, zmq::send_flags::none);
+    return false;
+  }
+  zmq::message_t status;
+  zmq::message_t value;
+  (void)request.recv(status, zmq::recv_flags::none);
+  if (status.more() == true)
+  { (void)request.recv(value, zmq::recv_flags::none); }
+  if (status.to_string_view() != "ok")
+  {
+    log_server("[cppyplot] server daemon on "s + daemon_addr + " failed: "s + value.to_string() + ", spawning a server"s);
+    return false;
+  }
+  process_.adopt(std::stol(value.to_string()));
+  return true;
+}
+
+CPPYPLOT_INLINE void session::launch_server()
+{
+  std::string daemon_addr = options_.daemon_addr;
+  if (daemon_addr.empty() == true)
+  {
+    const char* daemon_env = std::getenv("CPPYPLOT_DAEMON");
+    daemon_addr = (daemon_env != nullptr) ? daemon_env : "";
+  }
+  if ((daemon_addr.empty() == false) && (request_warm_server(daemon_addr) == true))
+  { return; }
+
+#ifdef CPPYPLOT_SERVER_DIR
+  std::filesystem::path server_dir(CPPYPLOT_SERVER_DIR);
+#else
+  std::filesystem::path server_dir = std::filesystem::path(__FILE__).parent_path();
+#endif
+  std::vector<std::string> args{options_.python_path, server_dir.string() + "/cppyplot_server.py"s};
+  for (auto& arg : server_args())
+  { args.push_back(std::move(arg)); }
+  if (process_.supervised() == true)
+  { args.insert(args.end(), {"--heartbeat_fd"s, std::to_string(server_process::heartbeat_fd)}); }
+  process_.spawn(args);
+}
+
+CPPYPLOT_INLINE void session::log_server(std::string_view line) const
+{
+  if (options_.server_log)
+  { options_.server_log(line); }
+  else
+  {
+    std::string out(line);
+    out += '\n';
+    std::cout << out << std::flush;
+  }
+}
+
+CPPYPLOT_INLINE void session::supervise()
+{
+  const auto log = [this](std::string_view line){ log_server(line); };
+  auto spawned_at     = std::chrono::steady_clock::now();
+  auto last_heartbeat = spawned_at;
+  unsigned int crash_streak = 0u;
+
+  while (stop_supervisor_.load() == false)
+  {
+    if (process_.poll_events(100ms, log) > 0u)
+    { last_heartbeat = std::chrono::steady_clock::now(); }
+
+    const auto now    = std::chrono::steady_clock::now();
+    const bool exited = (process_.running() == false);
+    const bool hung   =    (exited == false) && (options_.heartbeat_timeout.count() > 0) && (process_.has_heartbeat() == true)
+                        && ((now - last_heartbeat) > options_.heartbeat_timeout);
+    if ((exited == false) && (hung == false))
+    { continue; }
+
+    // stop() takes care of a server that does not exit in time
+    if (shutting_down_.load() == true)
+    {
+      if (exited == true)
+      { break; }
+      continue;
+    }
+
+    (void)process_.poll_events(0ms, log); // last words, e.g. a traceback
+    if (hung == true)
+    {
+      log("[cppyplot] python server on "s + zmq_ip_addr_ + " missed its heartbeats, killing it"s);
+      process_.kill();
+      (void)process_.wait_exit(1s);
+    }
+    else
+    { log("[cppyplot] python server on "s + zmq_ip_addr_ + " "s + process_.status_str()); }
+
+    // a server that keeps dying right after it was started is not restarted forever
+    crash_streak = ((now - spawned_at) > 1min) ? 1u : (crash_streak + 1u);
+    bool give_up = (crash_streak > options_.max_restarts);
+
+    const auto backoff_end = std::chrono::steady_clock::now() + 250ms*(1u << std::min(crash_streak, 5u));
+    while ((give_up == false) && (std::chrono::steady_clock::now() < backoff_end))
+    {
+      if ((stop_supervisor_.load() == true) || (shutting_down_.load() == true))
+      { return; }
+      std::this_thread::sleep_for(10ms);
+    }
+
+    if (give_up == false)
+    {
+      try
+      { launch_server(); }
+      catch (const std::system_error& err)
+      { log(err.what()); give_up = true; }
+    }
+    if (give_up == true)
+    {
+      log("[cppyplot] giving up on the python server on "s + zmq_ip_addr_);
+      {
+        std::lock_guard<std::mutex> lock(ready_mutex_);
+        server_failed_ = true;
+      }
+      ready_cv_.notify_all();
+      break;
+    }
+
+    restarts_.fetch_add(1u, std::memory_order_relaxed);
+    spawned_at     = std::chrono::steady_clock::now();
+    last_heartbeat = spawned_at;
+    log("[cppyplot] restarted the python server on "s + zmq_ip_addr_);
+  }
+  (void)process_.poll_events(0ms, log);
+}
+
+CPPYPLOT_INLINE session::session(const std::string& zmq_ip_addr, const server_options& options)
+  : id_(session::n_sessions_.fetch_add(1u)),
+    socket_(session::context_, ZMQ_XPUB), fan_in_(session::context_, ZMQ_PULL),
+    fan_in_addr_("inproc://cppyplot_session_"s + std::to_string(id_)),
+    reply_(session::context_, ZMQ_PULL), service_(session::context_, ZMQ_REP),
+    zmq_ip_addr_(zmq_ip_addr), options_(options)
+{ reset_stats(); }
+
+CPPYPLOT_INLINE void session::start()
+{
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  if (is_zmq_established_ == true)
+  { return; }
+
+  const std::string reply_endpoint   = side_endpoint(zmq_ip_addr_, "reply");
+  const std::string service_endpoint = side_endpoint(zmq_ip_addr_, "service");
+  socket_.bind(zmq_ip_addr_);
+  fan_in_.bind(fan_in_addr_);
+
+  // replies come back on a port picked by the OS on the same host, or next to the session's ipc path
+  reply_.set(zmq::sockopt::rcvtimeo, static_cast<int>(options_.reply_timeout.count()));
+  reply_.bind(reply_endpoint);
+  reply_addr_ = reply_.get(zmq::sockopt::last_endpoint);
+  service_.bind(service_endpoint);
+  service_addr_ = service_.get(zmq::sockopt::last_endpoint);
+
+  try
+  { launch_server(); }
+  catch (...)
+  {
+    socket_.unbind(zmq_ip_addr_);
+    fan_in_.unbind(fan_in_addr_);
+    reply_.unbind(reply_addr_);
+    service_.unbind(service_addr_);
+    throw;
+  }
+
+  stop_forwarder_  = false;
+  stop_supervisor_ = false;
+  shutting_down_   = false;
+  server_failed_   = false;
+  forwarder_ = std::thread(&session::forward, this);
+  if (process_.supervised() == true)
+  { supervisor_ = std::thread(&session::supervise, this); }
+  is_zmq_established_ = true;
+}
+
+CPPYPLOT_INLINE void session::ensure_ready()
+{
+  if (subscribed_.load(std::memory_order_acquire) == true)
+  { return; }
+
+  start();
+  std::unique_lock<std::mutex> lock(ready_mutex_);
+  ready_cv_.wait_for(lock, options_.startup_timeout, [this](){ return (subscribed_.load() == true) || (server_failed_.load() == true); });
+  if (subscribed_.load() == false)
+  {
+    throw std::runtime_error("cppyplot: python server on "s + zmq_ip_addr_
+                             + ((server_failed_.load() == true) ? " failed, see its output above"s : " did not subscribe in time"s));
+  }
+}
+
+CPPYPLOT_INLINE void session::stop()
+{
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  if (is_zmq_established_ == true)
+  {
+    // flush every plot already pushed, then the publisher belongs to this thread again
+    stop_forwarder_ = true;
+    forwarder_.join();
+
+    shutting_down_ = true;
+    zmq::message_t exit_msg("exit", 4);
+    socket_.send(exit_msg, zmq::send_flags::none);
+
+    // headless servers are waited for, the exit message may be dropped by the publisher.
+    // Interactive servers keep their figures open until they are closed, they exit on their own
+    // once the exit message arrived or they noticed this process closed the heartbeat pipe
+    if ((options_.headless == true) && (process_.supervised() == true) && (process_.wait_exit(options_.shutdown_timeout) == false))
+    {
+      process_.terminate();
+      if (process_.wait_exit(1s) == false)
+      {
+        process_.kill();
+        (void)process_.wait_exit(1s);
+      }
+    }
+
+    stop_supervisor_ = true;
+    if (supervisor_.joinable() == true)
+    { supervisor_.join(); }
+    process_.release();
+    set_subscribed(false);
+
+    is_zmq_established_ = false;
+    socket_.unbind(zmq_ip_addr_);
+    fan_in_.unbind(fan_in_addr_);
+    reply_.unbind(reply_addr_);
+    service_.unbind(service_addr_);
+  }
+}
+
+CPPYPLOT_INLINE session_stats session::stats() const noexcept
+{
+  session_stats out;
+  out.frames_sent   = frames_sent_.load(std::memory_order_relaxed);
+  out.bytes_sent    = bytes_sent_.load(std::memory_order_relaxed);
+  std::uint64_t published = frames_published_.load(std::memory_order_relaxed);
+  out.frames_queued = (out.frames_sent > published) ? (out.frames_sent - published) : 0u;
+  out.server_restarts = restarts_.load(std::memory_order_relaxed);
+
+  double elapsed_s = static_cast<double>(to_wire_time(frame_clock::now()) - stats_start_ns_.load())*1.0e-9;
+  if (elapsed_s > 0.0)
+  {
+    out.frames_per_sec = static_cast<double>(out.frames_sent)/elapsed_s;
+    out.bytes_per_sec  = static_cast<double>(out.bytes_sent)/elapsed_s;
+  }
+  out.serialize  = serialize_latency_.summary();
+  out.publish    = publish_latency_.summary();
+  out.round_trip = round_trip_latency_.summary();
+  return out;
+}
+
+CPPYPLOT_INLINE void session::reset_stats() noexcept
+{
+  frames_sent_      = 0u;
+  frames_published_ = 0u;
+  bytes_sent_       = 0u;
+  serialize_latency_.reset();
+  publish_latency_.reset();
+  round_trip_latency_.reset();
+  stats_start_ns_   = to_wire_time(frame_clock::now());
+}
+
+CPPYPLOT_INLINE bool session::schema_due(std::uint64_t schema_id)
+{
+  constexpr auto resend_interval = std::chrono::seconds(1);
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(schemas_mutex_);
+  const std::uint64_t restarts = restarts_.load(std::memory_order_relaxed);
+  if (restarts != schemas_restarts_)
+  {
+    sent_schemas_.clear();
+    schemas_restarts_ = restarts;
+  }
+
+  auto sent = std::find_if(sent_schemas_.begin(), sent_schemas_.end(), [schema_id](const auto& entry){ return entry.first == schema_id; });
+  if (sent == sent_schemas_.end())
+  {
+    sent_schemas_.emplace_back(schema_id, now);
+    return true;
+  }
+  if ((now - sent->second) < resend_interval)
+  { return false; }
+  sent->second = now;
+  return true;
+}
+
+CPPYPLOT_INLINE void session::discard_reply_payload()
+{
+  zmq::message_t payload;
+  while (reply_.get(zmq::sockopt::rcvmore) != 0)
+  { (void)reply_.recv(payload, zmq::recv_flags::none); }
+}
+
+CPPYPLOT_INLINE void session::wait_reply(std::uint64_t restarts_before, const std::string& key)
+{
+  const auto deadline = std::chrono::steady_clock::now() + options_.reply_timeout;
+  zmq::pollitem_t items[] = {{reply_.handle(), 0, ZMQ_POLLIN, 0}};
+  while (zmq::poll(items, 1, 100ms) == 0)
+  {
+    // the request went down with the previous server
+    if ((restarts_.load(std::memory_order_relaxed) != restarts_before) || (server_failed_.load() == true))
+    { throw std::runtime_error("cppyplot: python server on "s + zmq_ip_addr_ + " restarted before sending back '"s + key + "'"s); }
+    if (std::chrono::steady_clock::now() >= deadline)
+    { throw std::runtime_error("cppyplot: timed out waiting for '"s + key + "' from the server"s); }
+  }
+}
+
+CPPYPLOT_INLINE zmq::socket_t& session::producer_socket()
+{
+  thread_local std::map<std::size_t, zmq::socket_t> producers;
+  auto iter = producers.find(id_);
+  if (iter == producers.end())
+  {
+    zmq::socket_t push(session::context_, ZMQ_PUSH);
+    push.connect(fan_in_addr_);
+    iter = producers.emplace(id_, std::move(push)).first;
+  }
+  return iter->second;
+}
+
+// cppyplot
+CPPYPLOT_INLINE std::stringstream& cppyplot::plot_cmds()
+{
+  // the buffer of the instance this thread used last is cached, instance ids are never reused
+  // so the cached buffer of a destroyed instance is never returned
+  thread_local std::size_t cached_id = std::numeric_limits<std::size_t>::max();
+  thread_local std::stringstream* cached = nullptr;
+  if (cached_id == id_)
+  { return *cached; }
+
+  std::lock_guard<std::mutex> lock(staging_mutex_);
+  cached    = &staging_[std::this_thread::get_id()];
+  cached_id = id_;
+  return *cached;
+}
+
+CPPYPLOT_INLINE session& cppyplot::start_session(const std::string& name, const std::string& host_ip)
+{
+  std::lock_guard<std::mutex> lock(cppyplot::sessions_mutex_);
+  auto iter = cppyplot::sessions_.find(name);
+  if (iter == cppyplot::sessions_.end())
+  {
+    if (cppyplot::sessions_.empty())
+    { std::atexit(zmq_kill_command); }
+    iter = cppyplot::sessions_.emplace(name, std::make_unique<session>(host_ip, cppyplot::options_)).first;
+    cppyplot::session_order_.push_back(iter->second.get());
+  }
+  if (cppyplot::options_.lazy_spawn == false)
+  { iter->second->start(); }
+  return *(iter->second);
+}
+
+CPPYPLOT_INLINE session& cppyplot::route()
+{
+  session* target = session_;
+  if (target == nullptr)
+  {
+    std::lock_guard<std::mutex> lock(cppyplot::sessions_mutex_);
+    if (cppyplot::session_order_.empty())
+    { throw std::runtime_error("cppyplot: no session registered for round-robin routing"); }
+    std::size_t idx = cppyplot::next_session_.fetch_add(1u) % cppyplot::session_order_.size();
+    target = cppyplot::session_order_[idx];
+  }
+  target->ensure_ready();
+  return *target;
+}
+
+CPPYPLOT_INLINE cppyplot::cppyplot()
+  : session_(&cppyplot::start_session("default", cppyplot::zmq_ip_addr_))
+{ }
+
+CPPYPLOT_INLINE cppyplot::cppyplot(const std::string& session_name)
+  : session_(&cppyplot::get_session(session_name))
+{ }
+
+CPPYPLOT_INLINE cppyplot::cppyplot(session& target)
+  : session_(&target)
+{ }
+
+CPPYPLOT_INLINE cppyplot::cppyplot(round_robin_t)
+{ }
+
+CPPYPLOT_INLINE cppyplot::~cppyplot() = default;
+
+CPPYPLOT_INLINE session& cppyplot::get_session(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(cppyplot::sessions_mutex_);
+  return *(cppyplot::sessions_.at(name));
+}
+
+CPPYPLOT_INLINE void cppyplot::zmq_kill_command()
+{
+  std::lock_guard<std::mutex> lock(cppyplot::sessions_mutex_);
+  for (auto* target : cppyplot::session_order_)
+  { target->stop(); }
+}
+
+// utility functions
+CPPYPLOT_INLINE auto non_empty_line_idx(const std::string_view in_str)
+{
+  int new_line_pos        = -1;
+  unsigned int num_spaces = 0u;
+  for (unsigned int i = 0u; i < in_str.length(); i++)
+  {
+    if (in_str[i] == '\n')
+    { new_line_pos = i; num_spaces = 0u; }
+    else if (    (in_str[i] != ' ' ) 
+              && (in_str[i] != '\t'))
+    { break; }
+    else
+    { num_spaces ++; }
+  }
+  return std::make_tuple(new_line_pos+1, num_spaces);
+}
+
+CPPYPLOT_INLINE std::string dedent_string(const std::string_view raw_str)
+{
+  auto [occupied_line_start, num_spaces] = non_empty_line_idx(raw_str);
+  if (num_spaces == 0u)
+  { return std::string(raw_str); }
+  else
+  {
+    std::string out_str;
+    out_str.reserve(raw_str.length());
+    
+    int line_start = -1;
+    bool process_spaces = true;
+    int cur_space_count = 0;
+    for (unsigned int i = static_cast<unsigned int>(occupied_line_start); i < raw_str.length(); i++)
+    {
+      if (process_spaces == true)
+      {
+        if (raw_str[i] == '\n')
+        { 
+          process_spaces  = true;
+          line_start      = -1;
+          cur_space_count = 0;
+        }
+        else if ((raw_str[i] != ' ') && (raw_str[i] != '\t'))
+        {
+          process_spaces = false;
+          line_start     = i;
+        }
+        else
+        { cur_space_count++; }
+      }
+      else if (raw_str[i] == '\n')
+      {
+        if (line_start != -1)
+        {
+          line_start -= (cur_space_count - num_spaces);
+          out_str.append(raw_str.substr(line_start, i - line_start + 1u)); 
+        }
+        process_spaces  = true;
+        line_start      = -1;
+        cur_space_count = 0;
+      }
+    }
+    return out_str;
+  }
+}
+
+CPPYPLOT_INLINE std::pair<std::string, std::size_t> mapped_file_info(const std::string& path)
+{
+  std::error_code err;
+  const std::filesystem::path abs_path = std::filesystem::absolute(path, err);
+  std::uintmax_t n_bytes = 0u;
+  if (!err)
+  { n_bytes = std::filesystem::file_size(abs_path, err); }
+  if (err)
+  { throw std::runtime_error("cppyplot: can not map '"s + path + "': "s + err.message()); }
+  return {abs_path.string(), static_cast<std::size_t>(n_bytes)};
+}
+
+CPPYPLOT_INLINE std::string side_endpoint(const std::string& host_addr, std::string_view role)
+{
+  const std::size_t port_pos = host_addr.rfind(':');
+  if ((host_addr.rfind("tcp://"s, 0u) == 0u) && (port_pos > 5u))
+  { return host_addr.substr(0u, port_pos) + ":*"s; }
+  // not ipc://*, which names the socket relative to the working directory when TMPDIR is empty
+  if ((host_addr.rfind("ipc://"s, 0u) == 0u) && (host_addr.size() > 6u))
+  { return host_addr + "_"s + std::string(role); }
+  throw std::invalid_argument("cppyplot: '"s + host_addr + "' is not a tcp:// or ipc:// address, the python server runs in another process"s);
+}
+
+// reply|<req_id>|<key>|<type>|<n_elems>|<shape> or reply|<req_id>|<key>|error|<message>
+CPPYPLOT_INLINE reply_header parse_reply_header(const std::string_view header)
+{
+  std::array<std::string_view, 4> fields;
+  std::string_view rest = header;
+  for (auto& field : fields)
+  {
+    std::size_t end = rest.find('|');
+    if (end == std::string_view::npos)
+    { throw std::runtime_error("cppyplot: malformed reply header '"s + std::string(header) + "'"s); }
+    field = rest.substr(0u, end);
+    rest.remove_prefix(end + 1u);
+  }
+  if (fields[0] != "reply")
+  { throw std::runtime_error("cppyplot: malformed reply header '"s + std::string(header) + "'"s); }
+
+  reply_header out;
+  out.req_id  = std::stoull(std::string(fields[1]));
+  out.key     = std::string(fields[2]);
+  out.typestr = std::string(fields[3]);
+  if (out.typestr == "error")
+  {
+    out.error_msg = rest.empty() ? "unknown error"s : std::string(rest);
+    return out;
+  }
+
+  // shape is formatted as (d0,d1,...,), an empty shape is a scalar
+  std::string_view shape = rest.substr(rest.find('|') + 1u);
+  std::size_t axis_size = 0u;
+  bool has_digits = false;
+  for (char c : shape)
+  {
+    if ((c >= '0') && (c <= '9'))
+    { axis_size = axis_size*10u + static_cast<std::size_t>(c - '0'); has_digits = true; }
+    else if (has_digits == true)
+    { out.shape.push_back(axis_size); axis_size = 0u; has_digits = false; }
+  }
+  return out;
+}
+
+}
+
+#endif
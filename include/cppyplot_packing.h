@@ -0,0 +1,309 @@
+#ifndef _CPPYPLOT_PACKING_H_
+#define _CPPYPLOT_PACKING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include <zmq.hpp>
+
+namespace Cppyplot
+{
+
+template<typename T>
+std::string shape_str(const T& shape);
+
+/*
+  * Process-wide pool packing the payloads of copy-requiring containers, e.g. nested vectors or strided Eigen blocks.
+  * run() hands a list of tasks to the workers and the calling thread, every idle thread takes the next task until
+  * the list is done, so large containers split into row ranges spread over all threads.
+  * Workers are started on first use, one plot is packed at a time, other callers pack on their own thread meanwhile.
+*/
+class packing_pool{
+  public:
+    using task_t = std::function<void()>;
+
+    // runs every task and returns once all are done, rethrows the first exception of a task
+    static void run(std::vector<task_t>& tasks);
+
+    // threads packing one plot including the caller, 0 uses every hardware thread. Restarts the workers on the next run
+    static void set_threads(std::size_t n_threads) noexcept;
+    static std::size_t threads() noexcept;
+
+  private:
+    struct workers_t{
+      std::vector<std::thread> threads;
+      ~workers_t();
+    };
+
+    static void work(std::size_t seen);
+    static void drain(std::vector<task_t>& tasks) noexcept;
+    static void resize_locked(std::size_t n_workers);
+
+    static inline std::mutex run_mutex_{};    // held by the caller whose tasks the workers run
+    static inline std::mutex mutex_{};
+    static inline std::condition_variable wake_{}, done_{};
+    static inline std::vector<task_t>* tasks_ = nullptr;
+    static inline std::atomic<std::size_t> next_task_{0u};
+    static inline std::size_t generation_ = 0u;   // counts runs, a worker joins every run once
+    static inline std::size_t busy_ = 0u;         // workers still in the current run
+    static inline bool stop_ = false;
+    static inline std::exception_ptr error_{};
+    static inline std::atomic<std::size_t> n_threads_{0u};
+    static inline workers_t workers_{};
+};
+
+// containers providing packed_rows(cont) and pack_rows(cont, dst, begin, end), see cppyplot_container_support.h
+template<typename T, typename = void>
+struct is_row_packable : std::false_type {};
+
+template<typename T>
+struct is_row_packable<T, std::void_t<decltype(packed_rows(std::declval<const T&>()))>> : std::true_type {};
+
+template<typename T>
+inline constexpr bool is_row_packable_v = is_row_packable<T>::value;
+
+// containers sent as header and payload by the generic send_container
+template<typename T, typename = void>
+struct is_zmq_fillable : std::false_type {};
+
+template<typename T>
+struct is_zmq_fillable<T, std::void_t<decltype(fill_zmq_buffer(std::declval<const T&>(), std::declval<zmq::message_t&>()))>> : std::true_type {};
+
+template<typename T>
+inline constexpr bool is_zmq_fillable_v = is_zmq_fillable<T>::value;
+
+/*
+  * Payloads of the plot being sent from the current thread that are prepared before its first part is sent.
+  * Copy-requiring containers are packed on the packing_pool, send_container takes the packed payload
+  * instead of filling a new one.
+  * Payloads larger than the chunk size travel ahead of the plot as standalone messages, one stream|<id>|...
+  * message with the layout and one chunk|<id>|<index> message per chunk. The server receives every chunk
+  * into the preallocated array as it arrives, and the plot only carries chunked|<key>|<id>.
+  * Parts of one multipart message are only handed to the server once all of them arrived, standalone
+  * chunks let it receive while the client is still sending and keep at most a chunk in flight per stream.
+*/
+class packed_payloads{
+  private:
+    struct entry{
+      const void*           cont;
+      const std::type_info* type;
+      zmq::message_t        payload;
+      bool                  packed = false;
+      std::string           layout;          // <type>|<n elems>|<shape>|<order> of a streamed payload, empty otherwise
+      std::function<void(zmq::message_t&)> fill;   // fills the payload of streamed containers that are not packed
+      std::uint64_t         stream_id = 0u;
+    };
+
+    // keeps a streamed payload alive until zmq released all of its chunks
+    struct chunk_owner{
+      zmq::message_t           payload;
+      std::atomic<std::size_t> refs{1u};   // one per chunk in flight and one for the sender
+    };
+
+    std::deque<entry>                    entries_;   // tasks point into the entries, a deque keeps them in place
+    std::vector<packing_pool::task_t>    tasks_;
+    std::size_t                          n_bytes_ = 0u;
+    packed_payloads*                     previous_;
+
+    static inline std::atomic<std::size_t>   chunk_bytes_{std::size_t{64u} << 20u};
+    static inline std::atomic<std::uint64_t> next_stream_id_{1u};
+
+    static void release_chunk(void* data, void* hint) noexcept
+    {
+      (void)data;
+      chunk_owner* owner = static_cast<chunk_owner*>(hint);
+      if (owner->refs.fetch_sub(1u) == 1u)
+      { delete owner; }
+    }
+
+    entry* find(const void* cont, const std::type_info& type) noexcept
+    {
+      for (auto& prepared : entries_)
+      {
+        if ((prepared.cont == cont) && (*prepared.type == type))
+        { return &prepared; }
+      }
+      return nullptr;
+    }
+
+    static packed_payloads*& active() noexcept
+    {
+      thread_local packed_payloads* payloads = nullptr;
+      return payloads;
+    }
+
+  public:
+    // bytes of one task, whole rows are packed by the same task
+    static constexpr std::size_t task_bytes = std::size_t{1u} << 20u;
+    // plots with less to pack are packed on the calling thread
+    static constexpr std::size_t min_pool_bytes = std::size_t{1u} << 22u;
+
+    packed_payloads() : previous_(active())
+    { active() = this; }
+    packed_payloads(const packed_payloads& other) = delete;
+    packed_payloads& operator=(const packed_payloads& other) = delete;
+    ~packed_payloads()
+    { active() = previous_; }
+
+    // payloads above n_bytes are streamed in chunks of n_bytes, 0 sends every payload as one part of the plot
+    static void set_chunk_bytes(std::size_t n_bytes) noexcept
+    { chunk_bytes_ = n_bytes; }
+
+    static std::size_t chunk_bytes() noexcept
+    { return chunk_bytes_; }
+
+    // split the payload of cont into tasks if it has to be copied and mark it for streaming if it is large,
+    // other containers are ignored
+    template<typename T>
+    void add(const T& cont)
+    {
+      if constexpr (is_zmq_fillable_v<T>)
+      {
+        constexpr auto elem_type = unpack_type<T>();
+        const std::size_t n_bytes = elem_type.elem_size*container_size(cont);
+
+        std::size_t n_rows = 0u;
+        if constexpr (is_row_packable_v<T>)
+        { n_rows = packed_rows(cont); }
+        // strings and chars are decoded as text by the server, they are never streamed
+        const std::size_t chunk = chunk_bytes();
+        const bool streamed = (chunk > 0u) && (n_bytes > chunk) && (elem_type.typestr != 'c');
+        if ((n_rows == 0u) && (streamed == false))
+        { return; }
+
+        entries_.push_back(entry{&cont, &typeid(T), zmq::message_t{}, false, {}, {}, 0u});
+        entry* target = &entries_.back();
+        if (streamed == true)
+        {
+          target->layout =   std::string{elem_type.typestr} + "|" + std::to_string(container_size(cont)) + "|" + shape_str(container_shape(cont))
+                           + "|" + std::string{payload_order(cont)};
+          target->fill = [&cont](zmq::message_t& payload){ fill_zmq_buffer(cont, payload); };
+        }
+        if (n_rows == 0u)
+        { return; }
+
+        if constexpr (is_row_packable_v<T>)
+        {
+          target->payload.rebuild(n_bytes);
+          target->packed = true;
+          n_bytes_ += n_bytes;
+
+          const std::size_t rows_per_task = std::max<std::size_t>(1u, task_bytes/std::max<std::size_t>(1u, n_bytes/n_rows));
+          for (std::size_t begin = 0u; begin < n_rows; begin += rows_per_task)
+          {
+            const std::size_t end = std::min(n_rows, begin + rows_per_task);
+            tasks_.emplace_back([&cont, target, begin, end]()
+            { pack_rows(cont, static_cast<char*>(target->payload.data()), begin, end); });
+          }
+        }
+      }
+    }
+
+    // fill every payload added so far
+    void pack()
+    {
+      if (n_bytes_ < min_pool_bytes)
+      {
+        for (auto& task : tasks_)
+        { task(); }
+      }
+      else
+      { packing_pool::run(tasks_); }
+      tasks_.clear();
+    }
+
+    // send the streamed payloads ahead of the plot, socket must not be in the middle of a multipart message.
+    // Zero-copy payloads are filled here so the zero_copy_tracker of the plot waits for their chunks
+    void stream(zmq::socket_t& socket)
+    {
+      const std::size_t chunk = chunk_bytes();
+      if (chunk == 0u)
+      { return; }
+      for (auto& prepared : entries_)
+      {
+        if (prepared.layout.empty() == true)
+        { continue; }
+        if (prepared.packed == false)
+        { prepared.fill(prepared.payload); }
+
+        const std::size_t n_bytes  = prepared.payload.size();
+        const std::size_t n_chunks = (n_bytes + chunk - 1u)/chunk;
+        prepared.stream_id = next_stream_id_++;
+        const std::string id_str = std::to_string(prepared.stream_id);
+
+        // stream|<id>|<type>|<n elems>|<shape>|<order>|<chunks>|<chunk bytes>
+        zmq::message_t open("stream|" + id_str + "|" + prepared.layout + "|" + std::to_string(n_chunks) + "|" + std::to_string(chunk));
+        socket.send(open, zmq::send_flags::none);
+
+        chunk_owner* owner = new chunk_owner{std::move(prepared.payload)};
+        const char* data = static_cast<const char*>(owner->payload.data());
+        try
+        {
+          for (std::size_t i = 0u; i < n_chunks; i++)
+          {
+            zmq::message_t head("chunk|" + id_str + "|" + std::to_string(i));
+            owner->refs++;
+            zmq::message_t part((void*)(data + i*chunk), std::min(chunk, n_bytes - i*chunk), release_chunk, owner);
+            socket.send(head, zmq::send_flags::sndmore);
+            socket.send(part, zmq::send_flags::none);
+          }
+        }
+        catch (...)
+        {
+          release_chunk(nullptr, owner);
+          throw;
+        }
+        release_chunk(nullptr, owner);
+      }
+    }
+
+    // stream the payloads prepared by the active packed_payloads of this thread
+    static void stream_active(zmq::socket_t& socket)
+    {
+      packed_payloads* payloads = active();
+      if (payloads != nullptr)
+      { payloads->stream(socket); }
+    }
+
+    // moves the packed payload of cont into payload, false if cont was not packed
+    template<typename T>
+    static bool take(const T& cont, zmq::message_t& payload)
+    {
+      packed_payloads* payloads = active();
+      entry* packed = (payloads != nullptr) ? payloads->find(&cont, typeid(T)) : nullptr;
+      if ((packed == nullptr) || (packed->packed == false) || (packed->stream_id != 0u))
+      { return false; }
+      payload = std::move(packed->payload);
+      packed->cont = nullptr;
+      return true;
+    }
+
+    // stream id and size in bytes of the streamed payload of cont, id 0 if it was not streamed
+    template<typename T>
+    static std::pair<std::uint64_t, std::size_t> streamed(const T& cont)
+    {
+      packed_payloads* payloads = active();
+      entry* prepared = (payloads != nullptr) ? payloads->find(&cont, typeid(T)) : nullptr;
+      if ((prepared == nullptr) || (prepared->stream_id == 0u))
+      { return {0u, 0u}; }
+      prepared->cont = nullptr;
+      return {prepared->stream_id, unpack_type<T>().elem_size*container_size(cont)};
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef _CPPYPLOT_PROCESS_H_
+#define _CPPYPLOT_PROCESS_H_
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+  #include <sys/types.h>
+#endif
+
+namespace Cppyplot
+{
+
+/*
+  * Python server process spawned by a session.
+  * On POSIX the server is started with posix_spawn, its stdout/stderr are read back through a pipe
+  * and it writes one byte per heartbeat interval to a second pipe, mapped to heartbeat_fd in the child.
+  * A server handed out by cppyplot_daemon.py is adopted by its PID, only its exit is observed.
+  * On Windows the server is started detached with `start /min`, without output capture or supervision.
+  * Every member is safe to call from the session and its supervisor thread at the same time.
+*/
+class server_process{
+  private:
+    mutable std::mutex mutex_;
+#if !defined(_WIN32) && !defined(_WIN64)
+    pid_t       pid_ = -1;
+    int         output_fd_    = -1;
+    int         heartbeat_fd_ = -1;
+    bool        exited_ = false;
+    bool        adopted_ = false;
+    int         status_ = 0;
+    std::string partial_line_;
+
+    bool reap_locked();
+    void close_pipes_locked() noexcept;
+#else
+    bool        started_ = false;
+#endif
+
+  public:
+    static constexpr int heartbeat_fd = 3;
+
+    server_process() = default;
+    server_process(const server_process&) = delete;
+    server_process& operator=(const server_process&) = delete;
+    ~server_process() { release(); }
+
+    // args[0] is the executable, looked up in PATH. Throws std::system_error if the spawn fails
+    void spawn(const std::vector<std::string>& args);
+
+    // track a server started by someone else, e.g. the daemon
+    void adopt(long pid);
+
+    // false while nothing was spawned or once the process exited, reaps it
+    bool running();
+
+    bool wait_exit(std::chrono::milliseconds timeout);
+
+    // SIGTERM and SIGKILL
+    void terminate();
+    void kill();
+
+    // stop tracking the process and close the pipes, a running process is left alone
+    void release() noexcept;
+
+    // true if output, heartbeats and the exit status are observable on this platform
+    bool supervised() const noexcept;
+
+    // true if the current process writes heartbeats
+    bool has_heartbeat() const;
+
+    // wait up to timeout for server output and heartbeats, every complete output line is passed to on_line.
+    // returns the number of heartbeats received
+    std::size_t poll_events(std::chrono::milliseconds timeout, const std::function<void(std::string_view)>& on_line);
+
+    // "exited with code N", "killed by signal N" or "is running"
+    std::string status_str() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef _CPPYPLOT_PROVIDERS_H_
+#define _CPPYPLOT_PROVIDERS_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <zmq.hpp>
+
+namespace Cppyplot
+{
+
+/*
+  * Data the python servers pull on demand instead of receiving it up front, e.g. the tiles of an image_pyramid.
+  * Providers are registered process-wide under an id, every session answers requests for any of them
+  * on its service socket. A request is "<id>|<arguments>...", the reply is the parts the provider fills in,
+  * or a single "error|<message>" part.
+*/
+class data_providers{
+  public:
+    // fills the reply parts for the arguments of a request, throws to send an error back
+    using handler_t = std::function<void(const std::vector<std::string>& args, std::vector<zmq::message_t>& reply)>;
+
+    static std::uint64_t add(handler_t handler);
+
+    // waits for a request being answered by this provider, unknown ids are ignored
+    static void remove(std::uint64_t id) noexcept;
+
+    // receive one request from socket and send its reply
+    static void serve(zmq::socket_t& socket);
+
+    // called from a handler, work runs once the reply was sent and providers can be added and removed again
+    static void defer(std::function<void()> work);
+
+  private:
+    static inline thread_local std::vector<std::function<void()>> deferred_{};
+    static inline std::mutex mutex_{};
+    static inline std::map<std::uint64_t, handler_t> handlers_{};
+    static inline std::uint64_t next_id_ = 1u;
+};
+
+}
+
+#endif
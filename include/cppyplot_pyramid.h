@@ -0,0 +1,171 @@
+#ifndef _CPPYPLOT_PYRAMID_H_
+#define _CPPYPLOT_PYRAMID_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <zmq.hpp>
+
+namespace Cppyplot
+{
+
+// how 2x2 pixels are combined into one pixel of the next level
+enum class pyramid_filter{ mean, max };
+
+/*
+  * Row-major image with downsampled levels, each half the size of the previous one, down to a level
+  * that fits a single tile. _p(pyramid) sends only that coarsest level, the server pulls the tiles of the
+  * level matching the visible part of the axes from the client while zooming.
+  * Level 0 is the image itself, it is not copied and has to outlive the pyramid unchanged.
+*/
+template<typename T>
+class image_pyramid{
+  private:
+    struct level_t{
+      std::size_t rows, cols;
+      const T*    data;
+    };
+    std::vector<level_t>        levels_;
+    std::vector<std::vector<T>> storage_; // levels 1 and up
+    std::size_t   tile_size_;
+    std::uint64_t provider_id_ = 0u;
+
+    // runs reduce(begin, end) over the rows [0, n) split across threads
+    template<typename Reduce_t>
+    static void parallel_rows(std::size_t n, std::size_t row_cost, const Reduce_t& reduce)
+    {
+      const std::size_t min_rows  = std::max<std::size_t>(1u, (std::size_t{1u} << 18u)/std::max<std::size_t>(row_cost, 1u));
+      const std::size_t n_threads = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), n/min_rows);
+      if (n_threads <= 1u)
+      {
+        reduce(std::size_t{0u}, n);
+        return;
+      }
+      std::vector<std::thread> workers;
+      workers.reserve(n_threads - 1u);
+      const std::size_t chunk = n/n_threads;
+      for (std::size_t t = 1u; t < n_threads; t++)
+      { workers.emplace_back([&, t](){ reduce(t*chunk, (t + 1u == n_threads) ? n : (t + 1u)*chunk); }); }
+      reduce(std::size_t{0u}, chunk);
+      for (auto& worker : workers)
+      { worker.join(); }
+    }
+
+    static level_t downsample(const level_t& in, std::vector<T>& out_data, pyramid_filter filter)
+    {
+      level_t out{(in.rows + 1u)/2u, (in.cols + 1u)/2u, nullptr};
+      out_data.resize(out.rows*out.cols);
+      T* out_ptr = out_data.data();
+      parallel_rows(out.rows, 4u*in.cols, [&](std::size_t begin, std::size_t end)
+      {
+        for (std::size_t r = begin; r < end; r++)
+        {
+          // the last row and column of an odd sized level are combined with themselves
+          const T* row_0 = in.data + (2u*r)*in.cols;
+          const T* row_1 = in.data + std::min(2u*r + 1u, in.rows - 1u)*in.cols;
+          T* row_out = out_ptr + r*out.cols;
+          const std::size_t n_pairs = in.cols/2u;
+          if (filter == pyramid_filter::max)
+          {
+            for (std::size_t c = 0u; c < n_pairs; c++)
+            { row_out[c] = std::max(std::max(row_0[2u*c], row_0[2u*c + 1u]), std::max(row_1[2u*c], row_1[2u*c + 1u])); }
+          }
+          else
+          {
+            for (std::size_t c = 0u; c < n_pairs; c++)
+            {
+              const double sum = static_cast<double>(row_0[2u*c]) + static_cast<double>(row_0[2u*c + 1u])
+                                 + static_cast<double>(row_1[2u*c]) + static_cast<double>(row_1[2u*c + 1u]);
+              row_out[c] = static_cast<T>(sum*0.25);
+            }
+          }
+          if (n_pairs < out.cols)
+          {
+            const T last_0 = row_0[in.cols - 1u], last_1 = row_1[in.cols - 1u];
+            row_out[n_pairs] = (filter == pyramid_filter::max) ? std::max(last_0, last_1)
+                                                               : static_cast<T>((static_cast<double>(last_0) + static_cast<double>(last_1))*0.5);
+          }
+        }
+      });
+      out.data = out_data.data();
+      return out;
+    }
+
+  public:
+    using value_type = T;
+
+    image_pyramid(const T* image, std::size_t rows, std::size_t cols, std::size_t tile_size = 256u,
+                  pyramid_filter filter = pyramid_filter::mean)
+      : tile_size_(tile_size)
+    {
+      static_assert(std::is_arithmetic_v<T>, "image_pyramid holds integral and floating point pixels");
+      if ((rows == 0u) || (cols == 0u) || (tile_size == 0u))
+      { throw std::invalid_argument("cppyplot: image_pyramid needs a non-empty image and tile size"); }
+
+      levels_.push_back(level_t{rows, cols, image});
+      while (std::max(levels_.back().rows, levels_.back().cols) > tile_size_)
+      {
+        storage_.emplace_back();
+        levels_.push_back(downsample(levels_.back(), storage_.back(), filter));
+      }
+      provider_id_ = data_providers::add([this](const std::vector<std::string>& args, std::vector<zmq::message_t>& reply)
+      { serve_tile(args, reply); });
+    }
+
+    image_pyramid(const image_pyramid& other) = delete;
+    image_pyramid& operator=(const image_pyramid& other) = delete;
+
+    ~image_pyramid()
+    { data_providers::remove(provider_id_); }
+
+    std::size_t n_levels() const noexcept
+    { return levels_.size(); }
+
+    std::size_t rows(std::size_t level = 0u) const
+    { return levels_.at(level).rows; }
+
+    std::size_t cols(std::size_t level = 0u) const
+    { return levels_.at(level).cols; }
+
+    const T* data(std::size_t level = 0u) const
+    { return levels_.at(level).data; }
+
+    std::size_t tile_size() const noexcept
+    { return tile_size_; }
+
+    std::uint64_t provider_id() const noexcept
+    { return provider_id_; }
+
+    // tile|<level>|<tile row>|<tile col> is answered with ok|<shape> and the row-major pixels of the tile
+    void serve_tile(const std::vector<std::string>& args, std::vector<zmq::message_t>& reply) const
+    {
+      if ((args.size() != 4u) || (args[0] != "tile"))
+      { throw std::invalid_argument("image_pyramid only serves tile|<level>|<tile row>|<tile col>"); }
+      const level_t& level = levels_.at(std::stoull(args[1]));
+      const std::size_t row_0 = std::stoull(args[2])*tile_size_;
+      const std::size_t col_0 = std::stoull(args[3])*tile_size_;
+      if ((row_0 >= level.rows) || (col_0 >= level.cols))
+      { throw std::out_of_range("tile outside of level " + args[1]); }
+
+      const std::size_t n_rows = std::min(tile_size_, level.rows - row_0);
+      const std::size_t n_cols = std::min(tile_size_, level.cols - col_0);
+      zmq::message_t pixels(sizeof(T)*n_rows*n_cols);
+      for (std::size_t r = 0u; r < n_rows; r++)
+      {
+        std::memcpy(static_cast<char*>(pixels.data()) + sizeof(T)*r*n_cols,
+                    level.data + (row_0 + r)*level.cols + col_0, sizeof(T)*n_cols);
+      }
+      reply.emplace_back("ok|(" + std::to_string(n_rows) + "," + std::to_string(n_cols) + ",)");
+      reply.push_back(std::move(pixels));
+    }
+};
+
+}
+
+#endif
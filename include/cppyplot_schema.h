@@ -0,0 +1,217 @@
+#ifndef _CPPYPLOT_SCHEMA_H_
+#define _CPPYPLOT_SCHEMA_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cppyplot_types.h"
+#include "cppyplot_container_support.h"
+
+namespace Cppyplot
+{
+
+/*
+  * Containers whose type and shape are known at compile time: scalars, std::array, std::array of std::array
+  * and fixed size Eigen matrices and arrays. A plot sending only such containers is described by a
+  * frame_schema, the names, types, shapes and offsets of its containers in one payload. The schema is sent
+  * to a server once, every plot after that carries frame|<schema id> and the payload without any headers.
+*/
+template<typename T, typename = void>
+struct static_shape{ static constexpr bool value = false; };
+
+template<typename T>
+struct static_shape<T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>>{
+  static constexpr bool value = true;
+  using elem_t = T;
+  static constexpr std::size_t rank = 0u, rows = 0u, cols = 0u, n_elems = 1u;
+
+  static void copy(const T& data, char* dst) noexcept
+  { memcpy(dst, &data, sizeof(T)); }
+};
+
+template<typename T, std::size_t N>
+struct static_shape<std::array<T, N>, std::enable_if_t<static_shape<T>::value && (static_shape<T>::rank == 0u)>>{
+  static constexpr bool value = true;
+  using elem_t = T;
+  static constexpr std::size_t rank = 1u, rows = N, cols = 0u, n_elems = N;
+
+  static void copy(const std::array<T, N>& data, char* dst) noexcept
+  { memcpy(dst, data.data(), sizeof(T)*N); }
+};
+
+template<typename T, std::size_t N, std::size_t M>
+struct static_shape<std::array<std::array<T, M>, N>, std::enable_if_t<static_shape<T>::value && (static_shape<T>::rank == 0u)>>{
+  static constexpr bool value = true;
+  using elem_t = T;
+  static constexpr std::size_t rank = 2u, rows = N, cols = M, n_elems = N*M;
+
+  static void copy(const std::array<std::array<T, M>, N>& data, char* dst) noexcept
+  { pack_rows(data, dst, 0u, N); }
+};
+
+#if defined (EIGEN_AVAILABLE)
+// plain fixed size objects are contiguous, frames hold them row-major whatever their storage order
+template<typename Derived>
+struct static_eigen_shape{
+  static constexpr bool value = true;
+  using elem_t = typename Derived::Scalar;
+  static constexpr std::size_t rank = 2u;
+  static constexpr std::size_t rows = static_cast<std::size_t>(Derived::RowsAtCompileTime);
+  static constexpr std::size_t cols = static_cast<std::size_t>(Derived::ColsAtCompileTime);
+  static constexpr std::size_t n_elems = rows*cols;
+
+  static void copy(const Derived& data, char* dst) noexcept
+  {
+    if constexpr (Derived::IsRowMajor || (rows == 1u) || (cols == 1u))
+    { memcpy(dst, data.data(), sizeof(elem_t)*n_elems); }
+    else
+    { pack_rows(data, dst, 0u, rows); }
+  }
+};
+
+template<typename S, int R, int C, int O, int MR, int MC>
+struct static_shape<Eigen::Matrix<S, R, C, O, MR, MC>, std::enable_if_t<(R != Eigen::Dynamic) && (C != Eigen::Dynamic) && std::is_arithmetic_v<S>>>
+  : static_eigen_shape<Eigen::Matrix<S, R, C, O, MR, MC>> {};
+
+template<typename S, int R, int C, int O, int MR, int MC>
+struct static_shape<Eigen::Array<S, R, C, O, MR, MC>, std::enable_if_t<(R != Eigen::Dynamic) && (C != Eigen::Dynamic) && std::is_arithmetic_v<S>>>
+  : static_eigen_shape<Eigen::Array<S, R, C, O, MR, MC>> {};
+#endif
+
+struct schema_field{
+  char        typestr;
+  std::size_t n_elems;
+  std::size_t rank;       // scalars are sent with shape (0,) like create_header does
+  std::size_t shape[2];
+  std::size_t n_bytes;
+  std::size_t offset;     // in the frame payload, 8 byte aligned
+};
+
+// hands out schema ids unique within the process
+class schema_ids{
+  public:
+    static std::uint64_t next() noexcept
+    { return next_id_.fetch_add(1u, std::memory_order_relaxed); }
+
+  private:
+    static inline std::atomic<std::uint64_t> next_id_{1u};
+};
+
+template<typename... T>
+class frame_schema{
+  public:
+    static constexpr std::size_t n_fields = sizeof...(T);
+
+    // frames larger than this keep sending every container on its own, large std::arrays are sent without a copy
+    static constexpr std::size_t max_frame_bytes = std::size_t{1u} << 16u;
+
+  private:
+    static constexpr std::array<schema_field, n_fields> make_fields()
+    {
+      std::array<schema_field, n_fields> fields{
+        schema_field{unpack_type<typename static_shape<T>::elem_t>().typestr, static_shape<T>::n_elems, static_shape<T>::rank,
+                     {static_shape<T>::rows, static_shape<T>::cols}, sizeof(typename static_shape<T>::elem_t)*static_shape<T>::n_elems, 0u}...};
+      std::size_t offset = 0u;
+      for (std::size_t i = 0u; i < n_fields; i++)
+      {
+        fields[i].offset = offset;
+        offset += (fields[i].n_bytes + 7u) & ~std::size_t{7u};
+      }
+      return fields;
+    }
+
+    static constexpr std::size_t frame_bytes()
+    {
+      std::size_t n_bytes = 0u;
+      for (const auto& field : make_fields())
+      { n_bytes = field.offset + field.n_bytes; }
+      return n_bytes;
+    }
+
+    using names_t = std::array<std::string, n_fields>;
+
+    static bool same_names(const names_t& known, const std::array<std::string_view, n_fields>& names) noexcept
+    {
+      for (std::size_t i = 0u; i < n_fields; i++)
+      {
+        if (known[i] != names[i])
+        { return false; }
+      }
+      return true;
+    }
+
+  public:
+    static constexpr std::array<schema_field, n_fields> fields = make_fields();
+    static constexpr std::size_t n_bytes = frame_bytes();
+
+    // id of the schema with these container names, a call site sends the same names every time
+    static std::uint64_t id(const std::array<std::string_view, n_fields>& names)
+    {
+      thread_local std::uint64_t last_id = 0u;
+      thread_local names_t       last_names{};
+      if ((last_id != 0u) && same_names(last_names, names))
+      { return last_id; }
+
+      static std::mutex mutex;
+      static std::vector<std::pair<names_t, std::uint64_t>> known;
+      std::lock_guard<std::mutex> lock(mutex);
+      auto found = known.begin();
+      while ((found != known.end()) && (same_names(found->first, names) == false))
+      { found++; }
+      if (found == known.end())
+      {
+        names_t new_names;
+        for (std::size_t i = 0u; i < n_fields; i++)
+        { new_names[i] = std::string(names[i]); }
+        found = known.emplace(known.end(), std::move(new_names), schema_ids::next());
+      }
+      last_names = found->first;
+      last_id    = found->second;
+      return last_id;
+    }
+
+    // schema|<id>|<frame bytes>|, then <var_name>|<var_type>|<n_elems>|<array_shape>|<offset> per container
+    static std::string layout(std::uint64_t schema_id, const std::array<std::string_view, n_fields>& names)
+    {
+      std::string out = "schema|" + std::to_string(schema_id) + "|" + std::to_string(n_bytes);
+      for (std::size_t i = 0u; i < n_fields; i++)
+      {
+        const schema_field& field = fields[i];
+        out += "|" + std::string(names[i]) + "|" + std::string{field.typestr} + "|" + std::to_string(field.n_elems) + "|(";
+        for (std::size_t axis = 0u; axis < ((field.rank == 0u) ? 1u : field.rank); axis++)
+        { out += std::to_string(field.shape[axis]) + ","; }
+        out += ")|" + std::to_string(field.offset);
+      }
+      return out;
+    }
+
+    // every container at its offset in dst of n_bytes, padding is zeroed
+    static void pack(char* dst, const T&... conts) noexcept
+    {
+      memset(dst, 0, n_bytes);
+      std::size_t i = 0u;
+      ((static_shape<T>::copy(conts, dst + fields[i++].offset)), ...);
+    }
+};
+
+// whether a plot of these containers is sent as a frame of their schema
+template<typename... T>
+constexpr bool sent_as_frame()
+{
+  if constexpr ((sizeof...(T) > 0u) && (static_shape<T>::value && ...))
+  { return frame_schema<T...>::n_bytes <= frame_schema<T...>::max_frame_bytes; }
+  else
+  { return false; }
+}
+
+}
+
+#endif
@@ -1,78 +1,372 @@
-### Custom Imports ###
-lib_sym = {}
+#### command line arguments ####
+from argparse import ArgumentParser
+cmd_parser = ArgumentParser(description="Cppyplot server to handle plot commands")
+cmd_parser.add_argument("addr", nargs="?", default="tcp://127.0.0.1:5555", help="address for the subscriber to connect to")
+cmd_parser.add_argument("--reply_addr", type=str, default="", help="address to push variables requested by the client back to")
+cmd_parser.add_argument("--service_addr", type=str, default="", help="address to pull data from the client's data providers, e.g. image tiles")
+cmd_parser.add_argument("--headless", action="store_true", help="render with the Agg backend, no windows are opened")
+cmd_parser.add_argument("--workers", type=int, default=0, help="number of worker processes used to render plots in headless mode")
+cmd_parser.add_argument("--export_workers", type=int, default=0, help="number of worker processes rendering the frames of animations exported with animation_export")
+cmd_parser.add_argument("--stats_interval", type=float, default=10.0, help="seconds between [STATS] log lines, 0 disables them")
+cmd_parser.add_argument("--heartbeat_fd", type=int, default=-1, help="pipe to write a heartbeat to, set when the client supervises this server")
+cmd_parser.add_argument("--heartbeat_interval", type=float, default=1.0, help="seconds between heartbeats")
+cmd_parser.add_argument("--lib", action="append", default=[], help="alias=module[:attribute] added to the library registry, repeatable")
+cmd_parser.add_argument("--client_pid", type=int, default=-1, help="shut down once this process is gone, for servers not spawned by the client")
+cmd_args, _ = cmd_parser.parse_known_args()
 
-## Import numpy and register the object in the symbol table
+#### supervision ####
+# started before the slow imports below, the client counts the time without heartbeats
+import os
+import sys
+import time
+from threading import Thread
+
+parent_gone = False
+
+class PipeSafeStream:
+    # stdout/stderr are pipes read by the client, writes after it went away are dropped
+    def __init__(self, stream):
+        self.stream = stream
+
+    def write(self, text):
+        try:
+            n_written = self.stream.write(text)
+            self.stream.flush()
+            return n_written
+        except (OSError, ValueError):
+            return len(text)
+
+    def flush(self):
+        try:
+            self.stream.flush()
+        except (OSError, ValueError):
+            pass
+
+    def __getattr__(self, name):
+        return getattr(self.stream, name)
+
+def heartbeat(fd:int, interval:float)->None:
+    global parent_gone
+    while True:
+        try:
+            os.write(fd, b".")
+        except OSError:
+            # the client exited or crashed, finish what is queued and shut down
+            parent_gone = True
+            return
+        time.sleep(interval)
+
+def watch_client(pid:int, interval:float)->None:
+    global parent_gone
+    while True:
+        try:
+            os.kill(pid, 0)
+        except ProcessLookupError:
+            parent_gone = True
+            return
+        except PermissionError:
+            pass
+        time.sleep(interval)
+
+if (cmd_args.heartbeat_fd >= 0):
+    sys.stdout = PipeSafeStream(sys.stdout)
+    sys.stderr = PipeSafeStream(sys.stderr)
+    Thread(target=heartbeat, args=[cmd_args.heartbeat_fd, cmd_args.heartbeat_interval], daemon=True).start()
+elif (cmd_args.client_pid > 0):
+    Thread(target=watch_client, args=[cmd_args.client_pid, cmd_args.heartbeat_interval], daemon=True).start()
+
+### Library registry ###
+# every library symbol is a proxy in the symbol table, the library is imported the first time
+# a plot uses it. Entries are alias: (module, attribute), add more here or from c++ with add_library
+libraries = {
+    "plt":              ("matplotlib.pyplot", None),
+    "cm":               ("matplotlib.cm", None),
+    "FuncAnimation":    ("matplotlib.animation", "FuncAnimation"),
+    "sns":              ("seaborn", None),
+    "pd":               ("pandas", None),
+    "pa":               ("pyarrow", None),
+    "column":           ("bokeh.layouts", "column"),
+    "row":              ("bokeh.layouts", "row"),
+    "ColumnDataSource": ("bokeh.plotting", "ColumnDataSource"),
+    "figure":           ("bokeh.plotting", "figure"),
+    "output_file":      ("bokeh.plotting", "output_file"),
+    "show":             ("bokeh.plotting", "show"),
+    "go":               ("plotly.graph_objects", None),
+    "make_subplots":    ("plotly.subplots", "make_subplots"),
+    "pio":              ("plotly.io", None),
+    "dash":             ("dash", None),
+    "dcc":              ("dash", "dcc"),
+    "html":             ("dash", "html"),
+}
+for lib_spec in cmd_args.lib:
+    # alias=module or alias=module:attribute
+    alias, _, target = lib_spec.partition("=")
+    module, _, attribute = target.partition(":")
+    libraries[alias.strip()] = (module.strip(), attribute.strip() or None)
+
+# the backend has to be selected before pyplot is imported, which may happen lazily or already did in the daemon
+if (cmd_args.headless):
+    os.environ["MPLBACKEND"] = "Agg"
+    if ("matplotlib" in sys.modules):
+        sys.modules["matplotlib"].use("Agg")
+
+import importlib
+
+class LazySymbol:
+    # stands in for a library symbol until first use, then the symbol tables hold the real object
+    def __init__(self, alias:str, module:str, attribute):
+        self._lazy_alias     = alias
+        self._lazy_module    = module
+        self._lazy_attribute = attribute
+        self._lazy_value     = None
+
+    def _lazy_resolve(self):
+        if (self._lazy_value is None):
+            value = importlib.import_module(self._lazy_module)
+            if (self._lazy_attribute is not None):
+                value = getattr(value, self._lazy_attribute)
+            self._lazy_value = value
+            print(f"[INFO] imported {self._lazy_module} for '{self._lazy_alias}'")
+            for table in (base_symtable, aeval.symtable):
+                if (table.get(self._lazy_alias) is self):
+                    table[self._lazy_alias] = value
+        return self._lazy_value
+
+    def __getattr__(self, name):
+        return getattr(self._lazy_resolve(), name)
+
+    def __call__(self, *args, **kwargs):
+        return self._lazy_resolve()(*args, **kwargs)
+
+    def __getitem__(self, key):
+        return self._lazy_resolve()[key]
+
+    def __repr__(self):
+        return f"<lazy {self._lazy_module}{'' if self._lazy_attribute is None else '.' + self._lazy_attribute}>"
+
+lib_sym = {alias: LazySymbol(alias, module, attribute) for alias, (module, attribute) in libraries.items()}
+
+## numpy is used by the server itself
 import numpy as np
 lib_sym['np'] = np
-
-## Import matplotlib and register plot object in the symbol table
-import matplotlib.pyplot as plt
-import matplotlib.cm  as cm
-lib_sym['plt'] = plt
-lib_sym['cm'] = cm
-
-# from matplotlib.animation import FuncAnimation
-# lib_sym['FuncAnimation'] = FuncAnimation
-
-## Import seaborn and register seaborn object in the symbol table
-# import seaborn as sns
-# lib_sym['sns'] = sns
-
-## Import pandas and register pandas object in the symbol table
-# import pandas as pd
-# lib_sym['pd'] = pd
-
-# Import bokeh and register bokeh objects in the symbol table
-# from bokeh.layouts import column, row
-# lib_sym['column'] = column
-# lib_sym['row']    = row
-
-# from bokeh.plotting import ColumnDataSource, figure, output_file, show
-# lib_sym['ColumnDataSource'] = ColumnDataSource
-# lib_sym['figure']           = figure
-# lib_sym['output_file']      = output_file
-# lib_sym['show']             = show
-
-# Import plotly
-# import plotly.io as pio
-# # pio.renderers.default = "browser" # comment this when using Dash for rendering
-# import plotly.graph_objects as go
-# from plotly.subplots import make_subplots
-# lib_sym['go']            = go
-# lib_sym['make_subplots'] = make_subplots
-# lib_sym['pio']           = pio
-
-# Import dash
-# import dash
-# import dash_core_components as dcc
-# import dash_html_components as html
-# lib_sym['dash'] = dash
-# lib_sym['dcc'] = dcc
-# lib_sym['html'] = html
+plt = lib_sym['plt']
 
 #### required imports ####
 import zmq
-import sys
-from threading import Thread
-from struct import unpack
-from queue import Queue
+import json
+import socket
+import select
+import base64
+import hashlib
+import shutil
+import subprocess
+from threading import BoundedSemaphore, Lock
+from collections import deque, OrderedDict
+from weakref import WeakKeyDictionary
+from struct import unpack, pack
+from queue import Queue, Empty
+from http.server import ThreadingHTTPServer, BaseHTTPRequestHandler
 from asteval import Interpreter, make_symbol_table
+from concurrent.futures import ProcessPoolExecutor
+from multiprocessing import shared_memory, resource_tracker
 
 #### Globals #####
-recv_msgs   = Queue()
-parsed_msgs = Queue()
-kill_thread = False
+recv_msgs    = Queue()
+parsed_msgs  = Queue()
+kill_thread  = False
+reply_socket = None
+service_socket = None
+service_lock   = Lock()
 
 aeval = Interpreter()
 aeval.symtable = make_symbol_table(use_numpy=True, **lib_sym, no_print=False)
+base_symtable = aeval.symtable
+
+# plot being evaluated by plot_handler, (commands, data), export jobs evaluate it again on the export workers
+current_plot = None
+export_pool  = None
+
+# headless batch rendering
+render_pool     = None
+render_slots    = None
+render_pending  = 0
 
 # indices for data access
 SYM_IDX   = 1
 TYPE_IDX  = 2
 LEN_IDX   = 3
 SHAPE_IDX = 4
+ORDER_IDX = 5
+
+# indices for recv request access
+REQ_ID_IDX    = 1
+REQ_SYM_IDX   = 2
+REQ_TYPE_IDX  = 3
+REQ_ORDER_IDX = 4
+
+#### instrumentation ####
+class FrameStats:
+    # latencies are kept for the current log interval only, the window is bounded to stay cheap
+    WINDOW = 8192
+
+    def __init__(self):
+        self.lock = Lock()
+        self.start_interval()
+        # a restarted server joins a session whose sequence kept counting, gaps are counted from the first seq seen
+        self.first_seq = None
+        self.max_seq   = -1
+        self.n_seq_frames = 0
+
+    def start_interval(self):
+        self.t_start  = time.monotonic()
+        self.n_frames = 0
+        self.n_bytes  = 0
+        self.e2e_ns    = deque(maxlen=FrameStats.WINDOW)
+        self.parse_ns  = deque(maxlen=FrameStats.WINDOW)
+        self.render_ns = deque(maxlen=FrameStats.WINDOW)
+
+    def add_bytes(self, n_bytes:int)->None:
+        with self.lock:
+            self.n_bytes += n_bytes
+
+    def add_frame(self, frame_meta)->None:
+        # frame_meta: (seq, submit time ns, parse time ns)
+        with self.lock:
+            self.n_frames += 1
+            if (frame_meta is not None):
+                if (self.first_seq is None):
+                    self.first_seq = frame_meta[0]
+                self.n_seq_frames += 1
+                self.max_seq = max(self.max_seq, frame_meta[0])
+                self.parse_ns.append(frame_meta[2])
+
+    def add_render(self, frame_meta, render_ns:int)->None:
+        with self.lock:
+            self.render_ns.append(render_ns)
+            if (frame_meta is not None):
+                self.e2e_ns.append(max(time.time_ns() - frame_meta[1], 0))
+
+    def dropped(self)->int:
+        # the publisher drops whole frames when the server falls behind, sequence numbers have gaps then
+        if (self.first_seq is None):
+            return 0
+        return max(self.max_seq + 1 - self.first_seq - self.n_seq_frames, 0)
+
+    def log_line(self, queue_depths:dict)->str:
+        def percentiles(samples):
+            if (len(samples) == 0):
+                return "-"
+            p50, p99 = np.percentile(np.fromiter(samples, dtype=np.float64), [50, 99])*1.0e-6
+            return f"p50={p50:.2f}ms p99={p99:.2f}ms"
+
+        with self.lock:
+            elapsed = max(time.monotonic() - self.t_start, 1.0e-9)
+            line = (f"[STATS] {self.n_frames/elapsed:.1f} frames/s {self.n_bytes/elapsed/1.0e6:.2f} MB/s "
+                    f"dropped={self.dropped()} | e2e {percentiles(self.e2e_ns)} | parse {percentiles(self.parse_ns)} "
+                    f"| render {percentiles(self.render_ns)} | queues " + " ".join(f"{k}={v}" for k, v in queue_depths.items()))
+            self.start_interval()
+        return line
+
+frame_stats = FrameStats()
+
+def parse_frame_meta(zmq_message, t_parse_start:int):
+    # finalize|<frame seq>|<submit time ns>, plain "finalize" carries no timing
+    fields = zmq_message.split(b'|')
+    if (len(fields) < 3):
+        return None
+    return (int(fields[1]), int(fields[2]), time.perf_counter_ns() - t_parse_start)
+
+def log_stats()->None:
+    queue_depths = {"recv": recv_msgs.qsize(), "parsed": parsed_msgs.qsize(), "render": render_pending}
+    if ((frame_stats.n_frames == 0) and (not any(queue_depths.values()))):
+        with frame_stats.lock:
+            frame_stats.start_interval() # idle, nothing worth logging
+        return
+    print(frame_stats.log_line(queue_depths))
+
+#### chunked payloads ####
+# payloads larger than the client's chunk size arrive ahead of their plot as standalone messages,
+# received straight into the preallocated array by the subscriber thread while the client still sends
+class IncomingStream:
+    __slots__ = ("array", "view", "n_chunks", "chunk_bytes", "received", "t_open")
+
+    def __init__(self, data_type:str, data_shape:list, data_order:str, n_chunks:int, chunk_bytes:int):
+        self.array       = np.empty(data_shape, dtype="="+data_type, order=data_order)
+        # chunks are written in memory order, 'A' keeps the flat view of a Fortran ordered array a view
+        self.view        = memoryview(self.array.reshape(-1, order="A").view(np.uint8))
+        self.n_chunks    = n_chunks
+        self.chunk_bytes = chunk_bytes
+        self.received    = 0
+        self.t_open      = time.monotonic()
+
+streams = {}
+STREAM_EXPIRY_S = 60.0
+
+def purge_streams()->None:
+    # streams of plots the publisher dropped are never claimed, their arrays are released once they expired.
+    # Called from the subscriber and the parse thread, single dict operations are atomic under the GIL
+    now = time.monotonic()
+    for stream_id in [key for key, stream in list(streams.items()) if (now - stream.t_open > STREAM_EXPIRY_S)]:
+        streams.pop(stream_id, None)
+
+def open_stream(zmq_message)->None:
+    # 0: stream, 1: stream id, 2: var_type, 3: n_elems, 4: array_shape, 5: memory order, 6: chunks, 7: chunk bytes
+    info = zmq_message.decode("utf-8").split('|')
+    purge_streams()
+    streams[int(info[1])] = IncomingStream(info[2], parse_shape(info[4]), info[5], int(info[6]), int(info[7]))
+
+def recv_chunk(socket, zmq_message)->int:
+    # 0: chunk, 1: stream id, 2: chunk index; the chunk bytes follow
+    info   = zmq_message.split(b'|')
+    stream = streams.get(int(info[1]))
+    if (not socket.getsockopt(zmq.RCVMORE)):
+        return 0
+    if (stream is None):
+        return len(socket.recv(copy=False))
+    offset = int(info[2])*stream.chunk_bytes
+    target = stream.view[offset:offset + stream.chunk_bytes]
+    n_bytes = socket.recv_into(target)
+    if (n_bytes == len(target)):
+        stream.received += 1
+    return n_bytes
+
+def claim_stream(header, plot_data:dict)->dict:
+    # 0: chunked, 1: var_name, 2: stream id
+    info   = header.decode("utf-8").split('|')
+    stream = streams.pop(int(info[2]), None)
+    if ((stream is None) or (stream.received != stream.n_chunks)):
+        print(f"[Error] payload of {info[1]} was not received completely")
+    else:
+        plot_data[info[1]] = stream.array
+    return plot_data
 
 #### utility functions ####
+# payload frames of at least ZERO_COPY_MIN_BYTES stay in the memory zmq received them into and numpy arrays
+# are views over it, everything smaller is copied into bytes which is cheaper than tracking the zmq message.
+# CPPYPLOT_RECV_COPY=1 copies every frame, only used to benchmark both paths
+ZERO_COPY_MIN_BYTES = 65536
+recv_copy  = (os.environ.get("CPPYPLOT_RECV_COPY", "0") == "1")
+item_sizes = {typestr: np.dtype("="+typestr).itemsize for typestr in "cbBhHiIlLqQfd"}
+
+def payload_frames(header)->tuple:
+    # number of payload frames following header and whether they may be large enough to be received without a copy
+    if (header[0:5] == b"data|"):
+        info = header.split(b'|')
+        return (1, int(info[LEN_IDX])*item_sizes.get(info[TYPE_IDX].decode("utf-8"), 8) >= ZERO_COPY_MIN_BYTES)
+    if (header[0:8] == b"pyramid|"):
+        return (1, True)
+    if (header[0:6] == b"arrow|"):
+        return (int(header.split(b'|')[3]), True)
+    if (header[0:6] == b"frame|"):
+        return (1, False)
+    return (0, False)
+
+def recv_payload(socket):
+    if (recv_copy):
+        return socket.recv()
+    frame = socket.recv(copy=False)
+    return frame.bytes if (len(frame) < ZERO_COPY_MIN_BYTES) else frame.buffer
+
 def subscriber(addr):
     global recv_msgs
     context = zmq.Context()
@@ -83,9 +377,25 @@ def subscriber(addr):
     
     print("[INFO] started subscriber thread ")
     print(f"[INFO] listening to {addr}")
+    n_payloads, zero_copy = 0, False
     while (not kill_thread):
         if (socket.poll(50, zmq.POLLIN)):
+            if (n_payloads > 0):
+                zmq_message = recv_payload(socket) if zero_copy else socket.recv()
+                n_payloads -= 1
+                frame_stats.add_bytes(len(zmq_message))
+                recv_msgs.put(zmq_message)
+                continue
+
             zmq_message = socket.recv()
+            if (zmq_message[0:6] == b"chunk|"):
+                frame_stats.add_bytes(len(zmq_message) + recv_chunk(socket, zmq_message))
+                continue
+            frame_stats.add_bytes(len(zmq_message))
+            if (zmq_message[0:7] == b"stream|"):
+                open_stream(zmq_message)
+                continue
+            n_payloads, zero_copy = payload_frames(zmq_message)
             recv_msgs.put(zmq_message)
 
 def parse_shape(shape_str:str)->list:
@@ -100,99 +410,1061 @@ def parse_shape(shape_str:str)->list:
                 axis_size = ""
     return shape
 
-def handle_payload(data, data_type, data_len, data_shape, _unpack=unpack):
-    if ((data_type == 'c') or (data_type == 'b') or (data_type == 'B')):
-        data_converted = _unpack("="+(data_type*data_len), data)
-        return (b''.join(data_converted)).decode("utf-8")
+def handle_payload(data, data_type, data_len, data_shape, data_order='C', _unpack=unpack):
+    # char containers are text, signed and unsigned chars are numbers like every other integral type
+    if (data_type == 'c'):
+        return str(data, "utf-8")
     else:
         if data_shape[0] > 0:
-            return np.ndarray(data_shape, dtype="="+data_type, buffer=data)
+            # column-major Eigen matrices are sent as they are stored, 'F' views keep their (rows, cols) shape
+            return np.ndarray(data_shape, dtype="="+data_type, buffer=data, order=data_order)
         else:
-            return (_unpack("="+data_type, data))[0]
+            # native sizes, as numpy uses for arrays: 'l'/'L' are 8 bytes on LP64 but 4 in standard size
+            return (_unpack("@"+data_type, data))[0]
 
 def update_data(header, data, plot_data:dict)->dict:
     data_info     = header.decode("utf-8").split('|')
 
-    # 0: data, 1: var_name, 2: var_type, 3: n_elems, 4: array_shape
+    # 0: data, 1: var_name, 2: var_type, 3: n_elems, 4: array_shape, 5: memory order ('C' or 'F')
     data_type     = data_info[TYPE_IDX]
     data_len      = int(data_info[LEN_IDX])
     data_shape    = parse_shape(data_info[SHAPE_IDX])
-    plot_data[data_info[SYM_IDX]] = handle_payload(data, data_type, data_len, data_shape)
+    plot_data[data_info[SYM_IDX]] = handle_payload(data, data_type, data_len, data_shape, data_info[ORDER_IDX])
+
+    return plot_data
+
+def update_mapped(header, path, plot_data:dict)->dict:
+    # 0: mmap, 1: var_name, 2: var_type, 3: array_shape, 4: offset in bytes, 5: memory order ('C' or 'F')
+    mmap_info = header.decode("utf-8").split('|')
+    data_type = 'B' if (mmap_info[2] == 'c') else mmap_info[2]
+    plot_data[mmap_info[1]] = np.memmap(path.decode("utf-8"), dtype="="+data_type, mode="r", offset=int(mmap_info[4]),
+                                        shape=tuple(parse_shape(mmap_info[3])), order=mmap_info[5])
+    return plot_data
+
+def update_pyramid(header, data, plot_data:dict)->dict:
+    # 0: pyramid, 1: var_name, 2: var_type, 3: coarsest level shape, 4: rows, 5: cols, 6: tile size, 7: levels, 8: provider id
+    info  = header.decode("utf-8").split('|')
+    dtype = "=" + info[2]
+    top   = np.ndarray(parse_shape(info[3]), dtype=dtype, buffer=data)
+    plot_data[info[1]] = TiledImage(int(info[8]), dtype, int(info[4]), int(info[5]), int(info[6]), int(info[7]), top)
+    return plot_data
 
+def update_series(header, plot_data:dict)->dict:
+    # 0: series, 1: var_name, 2: var_type, 3: samples, 4: first x, 5: last x, 6: min, 7: max, 8: provider id
+    info = header.decode("utf-8").split('|')
+    plot_data[info[1]] = ZoomSeries(int(info[8]), "=" + info[2], int(info[3]), float(info[4]), float(info[5]), float(info[6]), float(info[7]))
     return plot_data
 
+def update_export(header, plot_data:dict)->dict:
+    # 0: export, 1: var_name, 2: provider id
+    info = header.decode("utf-8").split('|')
+    plot_data[info[1]] = AnimationExport(info[1], int(info[2]))
+    return plot_data
+
+arrow_schemas = {}
+
+def update_arrow(header, frames:list, plot_data:dict)->dict:
+    # 0: arrow, 1: var_name, 2: rows, 3: frames; the schema message, the record batch message and the column buffers follow
+    info = header.decode("utf-8").split('|')
+    rows = int(info[2])
+    pa   = lib_sym["pa"]
+    # a schema is decoded once, the batches of a record_batch all carry the same one
+    schema_key = bytes(frames[0])
+    schema = arrow_schemas.get(schema_key)
+    if (schema is None):
+        schema = pa.ipc.read_schema(pa.py_buffer(frames[0]))
+        arrow_schemas[schema_key] = schema
+
+    # columns are views over the received buffers, frames not a multiple of 8 bytes are followed by their padding
+    body   = iter(frames[2:])
+    arrays = []
+    for field in schema:
+        buffers = [None]
+        for _ in range(2 if pa.types.is_string(field.type) else 1):
+            buffer = next(body)
+            if (len(buffer) % 8 != 0):
+                next(body)
+            buffers.append(pa.py_buffer(buffer))
+        arrays.append(pa.Array.from_buffers(field.type, rows, buffers, null_count=0))
+    plot_data[info[1]] = pa.RecordBatch.from_arrays(arrays, schema=schema).to_pandas(split_blocks=True)
+    return plot_data
+
+frame_schemas = {}
+
+def register_schema(header)->None:
+    # 0: schema, 1: schema id, 2: frame bytes, then per container 5 entries: var_name, var_type, n_elems, array_shape, offset
+    info   = header.decode("utf-8").split('|')
+    fields = []
+    for i in range(3, len(info), 5):
+        name, data_type, data_len, data_shape, offset = info[i:i + 5]
+        n_bytes = int(data_len)*item_sizes[data_type]
+        fields.append((name, data_type, int(data_len), parse_shape(data_shape), int(offset), n_bytes))
+    frame_schemas[int(info[1])] = (int(info[2]), fields)
+
+def update_frame(header, data, plot_data:dict)->dict:
+    # 0: frame, 1: schema id; every container is a view over the one payload at the offset of its schema
+    schema_id = int(header.split(b'|')[1])
+    schema    = frame_schemas.get(schema_id)
+    if (schema is None):
+        raise KeyError(f"schema {schema_id} was not received yet")
+    frame_bytes, fields = schema
+    if (len(data) != frame_bytes):
+        raise ValueError(f"frame of {len(data)} bytes, schema {schema_id} has {frame_bytes}")
+    view = memoryview(data)
+    for name, data_type, data_len, data_shape, offset, n_bytes in fields:
+        plot_data[name] = handle_payload(view[offset:offset + n_bytes], data_type, data_len, data_shape)
+    return plot_data
+
+def update_recv(header, plot_recv:list)->list:
+    # 0: recv, 1: request id, 2: var_name, 3: var_type, 4: memory order ('C' or 'F')
+    recv_info = header.decode("utf-8").split('|')
+    plot_recv.append((int(recv_info[REQ_ID_IDX]), recv_info[REQ_SYM_IDX], recv_info[REQ_TYPE_IDX], recv_info[REQ_ORDER_IDX]))
+    return plot_recv
+
+def send_reply(req_id:int, key:str, data_type:str, order:str, error_msg=None)->None:
+    if ((error_msg is None) and (key not in aeval.symtable)):
+        error_msg = f"'{key}' is not defined"
+
+    if (error_msg is None):
+        try:
+            value = aeval.symtable[key]
+            if ((data_type == 'c') and isinstance(value, str)):
+                payload = np.frombuffer(value.encode("utf-8"), dtype=np.uint8)
+            else:
+                payload = np.asarray(value, dtype="="+data_type)
+            shape = payload.shape
+
+            # column-major containers receive the transposed C-order buffer
+            payload = np.ascontiguousarray(payload.T if order == 'F' else payload)
+            shape_str = "(" + "".join(f"{axis}," for axis in shape) + ")"
+            reply_socket.send_string(f"reply|{req_id}|{key}|{data_type}|{payload.size}|{shape_str}", zmq.SNDMORE)
+            reply_socket.send(payload, copy=False)
+            return
+        except (TypeError, ValueError) as e:
+            error_msg = str(e)
+
+    reply_socket.send_string(f"reply|{req_id}|{key}|error|{error_msg}", zmq.SNDMORE)
+    reply_socket.send(b"")
+
 def update_cmd(zmq_message)->str:
-    return zmq_message.decode("utf-8")
+    return str(zmq_message, "utf-8")
 
 def parse_msgs():
     global parsed_msgs, recv_msgs
     plot_cmd  = None
+    plot_artist = None
     plot_data = {}
+    plot_recv = []
+    t_parse_start = time.perf_counter_ns()
     while (not kill_thread):
-        zmq_message = None
-        if (not recv_msgs.empty()):
-            zmq_message = recv_msgs.get()
-            recv_msgs.task_done()
-        else:
+        # blocking with a timeout instead of polling, a spinning thread holds the GIL the subscriber needs
+        try:
+            zmq_message = recv_msgs.get(timeout=0.05)
+        except Empty:
+            if (streams):
+                purge_streams()
             continue
+        recv_msgs.task_done()
         
-        if (zmq_message[0:4] == b"data"):
+        if (zmq_message[0:5] == b"data|"):
             header = zmq_message
             data   = recv_msgs.get()
             recv_msgs.task_done()
             plot_data = update_data(header, data, plot_data)
 
-        elif (zmq_message[0:8] == b"finalize"):
-            parsed_msgs.put(("plot", plot_cmd, plot_data, ))
+        elif (zmq_message[0:5] == b"mmap|"):
+            header = zmq_message
+            path   = recv_msgs.get()
+            recv_msgs.task_done()
+            try:
+                plot_data = update_mapped(header, path, plot_data)
+            except (OSError, ValueError) as e:
+                print(f"[Error] mapping {path.decode('utf-8')} failed: {e}")
+
+        elif (zmq_message[0:8] == b"pyramid|"):
+            header = zmq_message
+            data   = recv_msgs.get()
+            recv_msgs.task_done()
+            plot_data = update_pyramid(header, data, plot_data)
+
+        elif (zmq_message[0:6] == b"arrow|"):
+            header = zmq_message
+            frames = []
+            for _ in range(int(header.split(b'|')[3])):
+                frames.append(recv_msgs.get())
+                recv_msgs.task_done()
+            try:
+                plot_data = update_arrow(header, frames, plot_data)
+            except (ImportError, ValueError, StopIteration) as e:
+                print(f"[Error] decoding record batch {header.split(b'|')[1].decode('utf-8')} failed: {e}")
+
+        elif (zmq_message[0:7] == b"schema|"):
+            register_schema(zmq_message)
+
+        elif (zmq_message[0:6] == b"frame|"):
+            header = zmq_message
+            data   = recv_msgs.get()
+            recv_msgs.task_done()
+            try:
+                plot_data = update_frame(header, data, plot_data)
+            except (KeyError, ValueError) as e:
+                print(f"[Error] decoding frame failed: {e}")
+
+        elif (zmq_message[0:8] == b"chunked|"):
+            plot_data = claim_stream(zmq_message, plot_data)
+
+        elif (zmq_message[0:7] == b"series|"):
+            plot_data = update_series(zmq_message, plot_data)
+
+        elif (zmq_message[0:7] == b"export|"):
+            plot_data = update_export(zmq_message, plot_data)
+
+        elif (zmq_message[0:5] == b"recv|"):
+            plot_recv = update_recv(zmq_message, plot_recv)
+
+        elif ((zmq_message[0:9] == b"finalize|") or (zmq_message == b"finalize")):
+            frame_meta = parse_frame_meta(zmq_message, t_parse_start)
+            frame_stats.add_frame(frame_meta)
+            if (streams):
+                purge_streams()
+            if (plot_artist is not None):
+                parsed_msgs.put(("artist", plot_artist, plot_data, frame_meta, ))
+            else:
+                parsed_msgs.put(("plot", plot_cmd, plot_data, plot_recv, frame_meta, ))
             plot_cmd = None
+            plot_artist = None
             plot_data = {}
+            plot_recv = []
         elif (zmq_message == b"exit"):
             parsed_msgs.put(("exit", 0,))
+        elif (zmq_message[0:7] == b"artist|"):
+            # artist|<name>, the data that follows replaces the artist's data
+            t_parse_start = time.perf_counter_ns()
+            plot_artist = zmq_message[7:].decode("utf-8")
         else:
+            t_parse_start = time.perf_counter_ns()
             plot_cmd = update_cmd(zmq_message)
 
-def plot_handler(plot_cmd:str, plot_data:dict)->None:
-    global aeval
+def plot_handler(plot_cmd:str, plot_data:dict, plot_recv:list, frame_meta=None)->None:
+    global aeval, current_plot
     print("[INFO] plotting ...")
+    t_render_start = time.perf_counter_ns()
     aeval.symtable = {**aeval.symtable, **plot_data}
+    current_plot = (plot_cmd, plot_data)
     aeval.eval(plot_cmd)
+    current_plot = None
 
+    error_msg = aeval.error_msg
     if (aeval.error_msg != None):
         aeval.error_msg = None
-        plt.figure(figsize=(6,5))
-        plt.title("Exception from ASTEVAL, check stdout", fontsize=14)
-        plt.show()
+        if (not any(plot_recv)):
+            plt.figure(figsize=(6,5))
+            plt.title("Exception from ASTEVAL, check stdout", fontsize=14)
+            plt.show()
+
+    # exports whose save was never reached would keep the client waiting
+    for value in plot_data.values():
+        if (isinstance(value, AnimationExport) and (not value.saved)):
+            reason = f"{value.key}.save was not called" if (error_msg is None) else f"the plot commands failed: {error_msg}"
+            value.notify(f"failed|{reason}")
+
+    # the client is blocked until every requested variable is sent back
+    for req_id, key, data_type, order in plot_recv:
+        send_reply(req_id, key, data_type, order, None if error_msg is None else str(error_msg))
+    frame_stats.add_render(frame_meta, time.perf_counter_ns() - t_render_start)
     print("[INFO] done")
 
+#### data pulled from the client ####
+SERVICE_TIMEOUT_MS = 5000
+
+def service_request(request:str)->list:
+    # "<provider id>|<arguments>..." to the client's data providers, returns the reply parts
+    global service_socket
+    if (cmd_args.service_addr == ""):
+        raise RuntimeError("the client did not pass a service address")
+    # export jobs notify the client from their encoder threads, one request at a time
+    with service_lock:
+        if (service_socket is None):
+            service_socket = zmq.Context.instance().socket(zmq.REQ)
+            service_socket.setsockopt(zmq.LINGER, 0)
+            service_socket.connect(cmd_args.service_addr)
+        service_socket.send_string(request)
+        if (not service_socket.poll(SERVICE_TIMEOUT_MS, zmq.POLLIN)):
+            # a REQ socket without its reply is stuck, start over with a new one
+            service_socket.close()
+            service_socket = None
+            raise TimeoutError(f"no reply from the client for '{request}'")
+        reply = service_socket.recv_multipart()
+    if (reply[0][0:6] == b"error|"):
+        raise RuntimeError(reply[0][6:].decode("utf-8"))
+    return reply
+
+class TiledImage:
+    # image_pyramid sent from c++, imshow() shows the level matching the view and pulls its tiles from the client
+    CACHE_BYTES = 256 << 20
+
+    def __init__(self, provider_id:int, dtype:str, rows:int, cols:int, tile:int, n_levels:int, top):
+        self.provider_id = provider_id
+        self.dtype    = dtype
+        self.rows     = rows
+        self.cols     = cols
+        self.tile     = tile
+        self.n_levels = n_levels
+        self.top      = top
+        self.image    = None
+        self.view     = None
+        self.origin   = "upper"
+        # (level, tile row, tile col) -> pixels, least recently used first
+        self.cache = OrderedDict({(n_levels - 1, 0, 0): top})
+        self.cache_bytes = top.nbytes
+
+    def tile_data(self, level:int, tile_row:int, tile_col:int):
+        key = (level, tile_row, tile_col)
+        if (key in self.cache):
+            self.cache.move_to_end(key)
+            return self.cache[key]
+        header, payload = service_request(f"{self.provider_id}|tile|{level}|{tile_row}|{tile_col}")
+        pixels = np.frombuffer(payload, dtype=self.dtype).reshape(parse_shape(header.decode("utf-8").split('|')[1]))
+        self.cache[key] = pixels
+        self.cache_bytes += pixels.nbytes
+        while ((self.cache_bytes > TiledImage.CACHE_BYTES) and (len(self.cache) > 1)):
+            _, evicted = self.cache.popitem(last=False)
+            self.cache_bytes -= evicted.nbytes
+        return pixels
+
+    def extent(self, col_0:float, col_1:float, row_0:float, row_1:float)->tuple:
+        # pixel centers at integer full resolution coordinates, like imshow without extent
+        if (self.origin == "lower"):
+            return (col_0 - 0.5, col_1 - 0.5, row_0 - 0.5, row_1 - 0.5)
+        return (col_0 - 0.5, col_1 - 0.5, row_1 - 0.5, row_0 - 0.5)
+
+    def imshow(self, ax=None, **kwargs):
+        ax = plt.gca() if (ax is None) else ax
+        self.origin = kwargs.get("origin", "upper")
+        kwargs.setdefault("interpolation", "nearest")
+        kwargs["extent"] = self.extent(0, self.cols, 0, self.rows)
+        self.image = ax.imshow(self.top, **kwargs)
+        # the extent changes with every refinement, the view must not follow it
+        ax.set_autoscale_on(False)
+        ax.callbacks.connect("xlim_changed", self.refine)
+        ax.callbacks.connect("ylim_changed", self.refine)
+        ax.figure.canvas.mpl_connect("resize_event", lambda event: self.refine(ax))
+        self.refine(ax)
+        return self.image
+
+    def refine(self, ax)->None:
+        x_lo, x_hi = sorted(ax.get_xlim())
+        y_lo, y_hi = sorted(ax.get_ylim())
+        col_0, col_1 = max(int(np.floor(x_lo + 0.5)), 0), min(int(np.ceil(x_hi + 0.5)), self.cols)
+        row_0, row_1 = max(int(np.floor(y_lo + 0.5)), 0), min(int(np.ceil(y_hi + 0.5)), self.rows)
+        if ((col_1 <= col_0) or (row_1 <= row_0)):
+            return
+
+        # coarsest level with at least one pixel per screen pixel
+        bbox = ax.get_window_extent()
+        density = max((col_1 - col_0)/max(bbox.width, 1.0), (row_1 - row_0)/max(bbox.height, 1.0))
+        level = int(np.clip(np.floor(np.log2(max(density, 1.0))), 0, self.n_levels - 1))
+        scale = 1 << level
+        span  = self.tile*scale
+        view  = (level, row_0//span, (row_1 - 1)//span + 1, col_0//span, (col_1 - 1)//span + 1)
+        if (view == self.view):
+            return
+
+        try:
+            pixels = np.block([[self.tile_data(level, tile_row, tile_col) for tile_col in range(view[3], view[4])]
+                               for tile_row in range(view[1], view[2])])
+        except (RuntimeError, TimeoutError, zmq.ZMQError) as e:
+            print(f"[Error] could not refine the image: {e}")
+            return
+        self.view = view
+        row_start, col_start = view[1]*span, view[3]*span
+        self.image.set_data(pixels)
+        self.image.set_extent(self.extent(col_start, col_start + pixels.shape[1]*scale, row_start, row_start + pixels.shape[0]*scale))
+
+class ZoomSeries:
+    # zoom_series sent from c++, plot() shows the visible range at screen resolution and pulls it again on every zoom
+    def __init__(self, provider_id:int, dtype:str, n:int, x_first:float, x_last:float, y_min:float, y_max:float):
+        self.provider_id = provider_id
+        self.dtype   = dtype
+        self.n       = n
+        self.x_first = x_first
+        self.x_last  = x_last
+        self.y_min   = y_min
+        self.y_max   = y_max
+        self.line    = None
+        self.view    = None
+        self.raw     = False
+
+    def plot(self, ax=None, **kwargs):
+        ax = plt.gca() if (ax is None) else ax
+        self.line, = ax.plot([], [], **kwargs)
+        # limits of the whole series, the line only ever holds the visible part
+        ax.update_datalim([(self.x_first, self.y_min), (self.x_last, self.y_max)])
+        ax.autoscale_view()
+        ax.callbacks.connect("xlim_changed", self.refine)
+        ax.figure.canvas.mpl_connect("resize_event", lambda event: self.refine(ax))
+        self.refine(ax)
+        return self.line
+
+    def refine(self, ax)->None:
+        x_lo, x_hi = sorted(ax.get_xlim())
+        n_px = max(int(ax.get_window_extent().width), 1)
+        view = (x_lo, x_hi, n_px)
+        if ((view == self.view) or (x_lo == x_hi)):
+            return
+        try:
+            header, x, y = service_request(f"{self.provider_id}|range|{x_lo!r}|{x_hi!r}|{n_px}")
+        except (RuntimeError, TimeoutError, zmq.ZMQError) as e:
+            print(f"[Error] could not refine the series: {e}")
+            return
+        self.view = view
+        self.raw  = (header.decode("utf-8").split('|')[2] == "raw")
+        self.line.set_data(np.frombuffer(x, dtype=np.float64), np.frombuffer(y, dtype=self.dtype))
+
+#### live plotly figures ####
+# the figure is sent to the browser once, updates are pushed over a websocket as binary typed arrays
+# and applied with Plotly.extendTraces/restyle instead of serializing the whole figure to json again
+LIVE_PAGE = """<!DOCTYPE html>
+<html><head><meta charset="utf-8"><title>cppyplot</title><script src="/plotly.min.js"></script></head>
+<body style="margin:0"><div id="figure" style="width:100vw;height:100vh"></div><script>
+const typed = {int8: Int8Array, uint8: Uint8Array, int16: Int16Array, uint16: Uint16Array,
+               int32: Int32Array, uint32: Uint32Array, float32: Float32Array, float64: Float64Array};
+const div = document.getElementById("figure");
+let applied = Promise.resolve();
+
+function unpack(buffer) {
+  // u32 json length, the json, then the arrays 8 byte aligned at offsets relative to the first one
+  const n     = new DataView(buffer).getUint32(0, true);
+  const msg   = JSON.parse(new TextDecoder().decode(new Uint8Array(buffer, 4, n)));
+  const start = Math.ceil((4 + n)/8)*8;
+  for (const key in msg.update) {
+    msg.update[key] = msg.update[key].map(([offset, dtype, shape]) => {
+      const flat = new typed[dtype](buffer, start + offset, shape.reduce((a, b) => a*b, 1));
+      if (shape.length < 2) { return flat; }
+      const rows = [];
+      for (let row = 0; row < shape[0]; row++) { rows.push(flat.subarray(row*shape[1], (row + 1)*shape[1])); }
+      return rows;
+    });
+  }
+  return msg;
+}
+
+function apply(msg) {
+  if (msg.op === "figure")  { return Plotly.react(div, msg.data, msg.layout, {responsive: true}); }
+  if (msg.op === "extend")  { return Plotly.extendTraces(div, msg.update, msg.traces, msg.max_points); }
+  if (msg.op === "restyle") { return Plotly.restyle(div, msg.update, msg.traces); }
+  return Plotly.relayout(div, msg.layout);
+}
+
+function connect() {
+  const ws = new WebSocket(`ws://${location.host}/ws`);
+  ws.binaryType = "arraybuffer";
+  ws.onmessage = (event) => {
+    const msg = (typeof event.data === "string") ? JSON.parse(event.data) : unpack(event.data);
+    applied = applied.then(() => apply(msg)).catch((e) => console.error(e));
+  };
+  ws.onclose = () => setTimeout(connect, 1000);
+}
+connect();
+</script></body></html>
+"""
+WS_GUID = b"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+JS_DTYPES = {"int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64"}
+
+def ws_header(opcode:int, n_bytes:int)->bytes:
+    if (n_bytes < 126):
+        return pack("!BB", 0x80 | opcode, n_bytes)
+    if (n_bytes < 65536):
+        return pack("!BBH", 0x80 | opcode, 126, n_bytes)
+    return pack("!BBQ", 0x80 | opcode, 127, n_bytes)
+
+def ws_recv_frame(conn)->tuple:
+    # frames from the browser are masked, only their opcode is of interest
+    def recv_exact(n_bytes:int)->bytes:
+        data = b""
+        while (len(data) < n_bytes):
+            part = conn.recv(n_bytes - len(data))
+            if (not part):
+                raise ConnectionError("websocket closed")
+            data += part
+        return data
+    first, second = recv_exact(2)
+    n_bytes = second & 0x7F
+    if (n_bytes == 126):
+        n_bytes = unpack("!H", recv_exact(2))[0]
+    elif (n_bytes == 127):
+        n_bytes = unpack("!Q", recv_exact(8))[0]
+    mask    = recv_exact(4) if (second & 0x80) else b"\0\0\0\0"
+    payload = bytes(b ^ mask[i % 4] for i, b in enumerate(recv_exact(n_bytes)))
+    return first & 0x0F, payload
+
+def js_array(value):
+    # typed arrays exist for 8 to 32 bit integers and floats, everything else is sent as float64
+    array = np.atleast_1d(np.asarray(value))
+    if (array.dtype.name not in JS_DTYPES):
+        array = array.astype(np.float32 if (array.dtype == np.float16) else np.float64)
+    return np.ascontiguousarray(array.astype(array.dtype.newbyteorder("<"), copy=False))
+
+class LiveHandler(BaseHTTPRequestHandler):
+    # browsers only accept the websocket upgrade from HTTP/1.1
+    protocol_version = "HTTP/1.1"
+
+    def do_GET(self):
+        live = self.server.live_figure
+        if (self.path == "/plotly.min.js"):
+            self.send_body(live.plotly_js(), "application/javascript")
+        elif ((self.path == "/ws") and (self.headers.get("Upgrade", "").lower() == "websocket")):
+            accept = base64.b64encode(hashlib.sha1(self.headers["Sec-WebSocket-Key"].encode("ascii") + WS_GUID).digest())
+            self.send_response(101)
+            self.send_header("Upgrade", "websocket")
+            self.send_header("Connection", "Upgrade")
+            self.send_header("Sec-WebSocket-Accept", accept.decode("ascii"))
+            self.end_headers()
+            self.close_connection = True
+            live.serve_client(self.connection)
+        elif (self.path in ("/", "/index.html")):
+            self.send_body(LIVE_PAGE.encode("utf-8"), "text/html")
+        else:
+            self.send_error(404)
+
+    def send_body(self, body:bytes, content_type:str)->None:
+        self.send_response(200)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, format, *args):
+        pass
+
+class LiveFigure:
+    # live_figure(fig) from plot commands, later plots push updates with extend, restyle and relayout
+    SEND_TIMEOUT_S = 2.0
+
+    def __init__(self, fig, host:str, port:int):
+        self.lock    = Lock()
+        self.clients = []
+        self.js      = None
+        self.set_figure(fig)
+        self.server  = ThreadingHTTPServer((host, port), LiveHandler)
+        self.server.daemon_threads = True
+        self.server.live_figure    = self
+        Thread(target=self.server.serve_forever, daemon=True).start()
+        print(f"[INFO] live figure at http://{host}:{self.server.server_address[1]}")
+
+    def plotly_js(self)->bytes:
+        if (self.js is None):
+            from plotly.offline import get_plotlyjs
+            self.js = get_plotlyjs().encode("utf-8")
+        return self.js
+
+    def set_figure(self, fig)->None:
+        # browsers connecting later start from this figure, updates pushed before are not replayed
+        figure = json.loads(fig.to_json())
+        self.figure = json.dumps({"op": "figure", "data": figure.get("data", []), "layout": figure.get("layout", {})}).encode("utf-8")
+        self.broadcast([ws_header(0x1, len(self.figure)), self.figure])
+
+    def serve_client(self, conn)->None:
+        conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        conn.settimeout(LiveFigure.SEND_TIMEOUT_S)
+        with self.lock:
+            try:
+                conn.sendall(ws_header(0x1, len(self.figure)) + self.figure)
+            except OSError:
+                return
+            self.clients.append(conn)
+        # the connection is written by broadcast, this thread only waits for it to close. The timeout stays on
+        # the socket for the sends, an idle browser is waited for with select and only frames it started are read
+        try:
+            while True:
+                select.select([conn], [], [])
+                opcode, payload = ws_recv_frame(conn)
+                if (opcode == 0x8):
+                    break
+                if (opcode == 0x9):
+                    with self.lock:
+                        conn.sendall(ws_header(0xA, len(payload)) + payload)
+        except (socket.timeout, OSError, ConnectionError, ValueError):
+            # a frame stalled for SEND_TIMEOUT_S, the browser closed or broadcast dropped it
+            pass
+        with self.lock:
+            if (conn in self.clients):
+                self.clients.remove(conn)
+
+    def broadcast(self, parts:list)->None:
+        # a browser not keeping up within SEND_TIMEOUT_S is dropped instead of stalling the plots
+        with self.lock:
+            for conn in list(self.clients):
+                try:
+                    for part in parts:
+                        conn.sendall(part)
+                except OSError:
+                    self.clients.remove(conn)
+                    conn.close()
+
+    def push(self, msg:dict, columns:dict, n_traces:int)->None:
+        # one binary message: u32 json length, the json, then the arrays 8 byte aligned at offsets relative to the first
+        arrays = []
+        offset = 0
+        msg["update"] = {}
+        for key, values in columns.items():
+            if (len(values) != n_traces):
+                raise ValueError(f"'{key}' has {len(values)} arrays for {n_traces} traces")
+            msg["update"][key] = []
+            for value in values:
+                array = js_array(value)
+                arrays.append(array)
+                msg["update"][key].append([offset, array.dtype.name, list(array.shape)])
+                offset += array.nbytes + (-array.nbytes % 8)
+        msg_json = json.dumps(msg).encode("utf-8")
+        parts = [pack("<I", len(msg_json)), msg_json, bytes(-(4 + len(msg_json)) % 8)]
+        for array in arrays:
+            parts.append(memoryview(array).cast("B"))
+            parts.append(bytes(-array.nbytes % 8))
+        parts.insert(0, ws_header(0x2, sum(len(part) for part in parts)))
+        self.broadcast(parts)
+
+    def extend(self, traces, max_points=None, **columns)->None:
+        # live.extend(0, x=t, y=v) or live.extend([0, 1], x=[t, t], y=[v, w]), max_points keeps the newest points
+        traces, columns = live_traces(traces, columns)
+        self.push({"op": "extend", "traces": traces, "max_points": max_points}, columns, len(traces))
+
+    def restyle(self, traces, **columns)->None:
+        # live.restyle(0, z=z) replaces the data of the traces, 2-D arrays become rows
+        traces, columns = live_traces(traces, columns)
+        self.push({"op": "restyle", "traces": traces}, columns, len(traces))
+
+    def relayout(self, **layout)->None:
+        msg = json.dumps({"op": "relayout", "layout": layout}).encode("utf-8")
+        self.broadcast([ws_header(0x1, len(msg)), msg])
+
+def live_traces(traces, columns:dict)->tuple:
+    if (np.ndim(traces) == 0):
+        return [int(traces)], {key: [value] for key, value in columns.items()}
+    return [int(trace) for trace in traces], columns
+
+live_figures = {}
+
+def live_figure(fig, port:int=8050, host:str="127.0.0.1")->LiveFigure:
+    # one server per port, a figure passed again for the same port replaces the one shown
+    live = live_figures.get(port)
+    if (live is None):
+        live = LiveFigure(fig, host, port)
+        live_figures[port] = live
+    else:
+        live.set_figure(fig)
+    return live
+
+base_symtable["live_figure"] = live_figure
+
+#### artist updates ####
+# figures with artists updated by blitting: figure -> {"background": saved canvas or None, "artists": [...]}
+blit_figures = WeakKeyDictionary()
+
+def set_artist_data(artist, values:list)->None:
+    # values in the order they were sent
+    from matplotlib.lines import Line2D
+    from matplotlib.collections import PathCollection, QuadMesh
+    if (isinstance(artist, Line2D)):
+        # y, or x and y
+        if (len(values) == 1):
+            artist.set_ydata(np.atleast_1d(values[0]))
+        else:
+            artist.set_data(np.atleast_1d(values[0]), np.atleast_1d(values[1]))
+    elif (isinstance(artist, PathCollection)):
+        # (N,2) offsets or x and y, optionally followed by the values mapped to colors
+        if (np.ndim(values[0]) == 2):
+            offsets, values = values[0], values[1:]
+        else:
+            offsets, values = np.column_stack((np.atleast_1d(values[0]), np.atleast_1d(values[1]))), values[2:]
+        artist.set_offsets(offsets)
+        if (len(values) > 0):
+            artist.set_array(np.ravel(values[0]))
+    elif (isinstance(artist, QuadMesh)):
+        artist.set_array(values[0])
+    elif (hasattr(artist, "set_data")):
+        # images and anything else following the set_data convention
+        artist.set_data(*values)
+    else:
+        raise TypeError(f"{type(artist).__name__} has no set_data, set_offsets or set_array")
+
+def on_figure_draw(event)->None:
+    # a full redraw, e.g. after a resize or plt.pause, invalidates the saved background
+    state = blit_figures.get(event.canvas.figure)
+    if (state is not None):
+        state["background"] = event.canvas.copy_from_bbox(event.canvas.figure.bbox)
+        for artist in state["artists"]:
+            event.canvas.figure.draw_artist(artist)
+
+def blit_artist(artist)->None:
+    fig = artist.figure
+    canvas = fig.canvas
+    if (not getattr(canvas, "supports_blit", False)):
+        canvas.draw_idle()
+        canvas.flush_events()
+        return
+
+    state = blit_figures.get(fig)
+    if (state is None):
+        state = {"background": None, "artists": []}
+        blit_figures[fig] = state
+        canvas.mpl_connect("draw_event", on_figure_draw)
+    if (artist not in state["artists"]):
+        # animated artists are left out of full redraws and drawn on top of the background
+        artist.set_animated(True)
+        state["artists"].append(artist)
+        state["background"] = None
+    if (state["background"] is None):
+        canvas.draw()
+
+    canvas.restore_region(state["background"])
+    for animated in state["artists"]:
+        fig.draw_artist(animated)
+    canvas.blit(fig.bbox)
+    canvas.flush_events()
+
+def artist_handler(name:str, plot_data:dict, frame_meta=None)->None:
+    t_render_start = time.perf_counter_ns()
+    artist = aeval.symtable.get(name, None)
+    if (artist is None):
+        print(f"[Error] no artist named '{name}', create it with plot commands first")
+    elif (len(plot_data) == 0):
+        print(f"[Error] no data sent for artist '{name}'")
+    else:
+        try:
+            set_artist_data(artist, list(plot_data.values()))
+            # without a window the next savefig draws the new data
+            if (not cmd_args.headless):
+                blit_artist(artist)
+        except Exception as e:
+            print(f"[Error] updating artist '{name}' failed: {e}")
+    frame_stats.add_render(frame_meta, time.perf_counter_ns() - t_render_start)
+
+#### headless batch rendering ####
+def share_payloads(plot_data:dict)->tuple:
+    # arrays are copied once into shared memory, workers map them without copying
+    shared_data = {}
+    shm_handles = []
+    for key, value in plot_data.items():
+        if isinstance(value, np.memmap):
+            # workers map the file themselves
+            order = 'F' if (value.flags.f_contiguous and not value.flags.c_contiguous) else 'C'
+            shared_data[key] = ("mmap", value.filename, value.offset, value.shape, value.dtype.str, order)
+        elif isinstance(value, np.ndarray):
+            shm = shared_memory.SharedMemory(create=True, size=max(value.nbytes, 1))
+            np.ndarray(value.shape, dtype=value.dtype, buffer=shm.buf)[...] = value
+            shared_data[key] = ("shm", shm.name, value.shape, value.dtype.str)
+            shm_handles.append(shm)
+        else:
+            shared_data[key] = ("obj", value)
+    return shared_data, shm_handles
+
+def map_payloads(shared_data:dict)->tuple:
+    # inside a worker process, the payloads of share_payloads without copying them
+    shm_handles = []
+    plot_data   = {}
+    for key, value in shared_data.items():
+        if (value[0] == "shm"):
+            shm = shared_memory.SharedMemory(name=value[1])
+            resource_tracker.unregister(shm._name, "shared_memory") # owned by the parent
+            shm_handles.append(shm)
+            plot_data[key] = np.ndarray(value[2], dtype=value[3], buffer=shm.buf)
+        elif (value[0] == "mmap"):
+            plot_data[key] = np.memmap(value[1], dtype=value[4], mode="r", offset=value[2], shape=value[3], order=value[5])
+        else:
+            plot_data[key] = value[1]
+    return plot_data, shm_handles
+
+def eval_in_worker(plot_cmd:str, plot_data:dict, shm_handles:list):
+    # every job starts from a clean symbol table, returns the error of the commands if any
+    global aeval
+    aeval.symtable = {**base_symtable, **plot_data}
+    aeval.eval(plot_cmd)
+    if ("matplotlib.pyplot" in sys.modules):
+        sys.modules["matplotlib.pyplot"].close("all")
+    error_msg = aeval.error_msg
+    aeval.error_msg = None
+
+    # drop every view into the shared buffers before unmapping them
+    aeval.symtable = base_symtable
+    plot_data.clear()
+    for shm in shm_handles:
+        try:
+            shm.close()
+        except BufferError:
+            pass # a view escaped into user state, mapping is released with the process
+    return error_msg
+
+def render_job(plot_cmd:str, shared_data:dict):
+    # runs inside a worker process
+    plot_data, shm_handles = map_payloads(shared_data)
+    error_msg = eval_in_worker(plot_cmd, plot_data, shm_handles)
+    return None if error_msg is None else str(error_msg)
+
+def render_job_done(future, shm_handles, frame_meta, t_render_start):
+    global render_pending
+    for shm in shm_handles:
+        shm.close()
+        shm.unlink()
+    with frame_stats.lock:
+        render_pending -= 1
+    render_slots.release()
+    frame_stats.add_render(frame_meta, time.perf_counter_ns() - t_render_start)
+    if (future.exception() is not None):
+        print(f"[Error] render worker failed: {future.exception()}")
+    elif (future.result() is not None):
+        print(f"[Error] exception from ASTEVAL in render worker: {future.result()}")
+
+def batch_plot_handler(plot_cmd:str, plot_data:dict, plot_recv:list, frame_meta=None)->None:
+    global render_pending
+    # variables requested back are only available in this interpreter, exports notify the client from it
+    if (any(plot_recv) or any(isinstance(value, AnimationExport) for value in plot_data.values())):
+        plot_handler(plot_cmd, plot_data, plot_recv, frame_meta)
+        return
+
+    # bound the number of in-flight jobs so shared memory does not grow without limit
+    render_slots.acquire()
+    with frame_stats.lock:
+        render_pending += 1
+    t_render_start = time.perf_counter_ns()
+    shared_data, shm_handles = share_payloads(plot_data)
+    future = render_pool.submit(render_job, plot_cmd, shared_data)
+    future.add_done_callback(lambda f: render_job_done(f, shm_handles, frame_meta, t_render_start))
+
+def start_render_pool(n_workers:int)->None:
+    global render_pool, render_slots
+    render_pool  = ProcessPoolExecutor(max_workers=n_workers)
+    render_slots = BoundedSemaphore(2*n_workers)
+
+    # spawn every worker now, before the zmq threads exist
+    for future in [render_pool.submit(int, 0) for _ in range(n_workers)]:
+        future.result()
+    print(f"[INFO] headless render pool started with {n_workers} workers")
+
+#### animation export ####
+class AnimationExport:
+    # animation_export sent from c++, save() hands the animation to the export workers and returns, the frames
+    # are encoded into the file in the background and the client is notified once it is written
+    CHUNK_FRAMES = 32
+
+    def __init__(self, key:str, provider_id:int):
+        self.key = key
+        self.provider_id = provider_id
+        self.saved = False
+
+    def notify(self, message:str)->None:
+        try:
+            service_request(f"{self.provider_id}|{message}")
+        except (RuntimeError, TimeoutError, zmq.ZMQError) as e:
+            print(f"[Error] could not notify the client of the export: {e}")
+
+    def save(self, anim, path:str, fps=None, dpi=None)->None:
+        self.saved = True
+        t_start = time.monotonic()
+        path = os.path.abspath(path)
+        if ((export_pool is None) or (current_plot is None)):
+            # without export workers the animation is saved in place, holding up the plots like anim.save
+            print("[Warning] no export workers, use set_export_workers to export animations in the background")
+            try:
+                anim.save(path, fps=fps, dpi=dpi)
+                self.notify(f"done|{path}|{getattr(anim, '_save_count', 0) or 0}|{time.monotonic() - t_start:.3f}")
+            except Exception as e:
+                self.notify(f"failed|{e}")
+            return
+
+        fps = (1000.0/anim._interval) if (fps is None) else fps
+        dpi = anim._fig.dpi if (dpi is None) else dpi
+        n_frames = getattr(anim, "_save_count", None)
+        if (n_frames is None):
+            n_frames = sum(1 for _ in anim.new_saved_frame_seq())
+
+        # every worker evaluates the plot commands again, with a FrameRange in place of this job
+        plot_cmd, plot_data = current_plot
+        shared_data, shm_handles = share_payloads({key: value for key, value in plot_data.items() if (value is not self)})
+        chunk = max(1, min(AnimationExport.CHUNK_FRAMES, -(-n_frames//export_pool._max_workers)))
+        futures = [export_pool.submit(export_frames_job, plot_cmd, shared_data, self.key, first, min(first + chunk, n_frames), dpi)
+                   for first in range(0, n_frames, chunk)]
+        Thread(target=encode_animation, args=[self, futures, shm_handles, path, fps, t_start], daemon=True).start()
+        print(f"[INFO] exporting {n_frames} frames to {path} in the background")
+
+class FrameRange:
+    # stands in for the animation_export inside export workers, save() renders the frames [first, last) of anim
+    def __init__(self, first:int, last:int, dpi:float):
+        self.first  = first
+        self.last   = last
+        self.dpi    = dpi
+        self.size   = None
+        self.frames = []
+
+    def save(self, anim, path=None, fps=None, dpi=None)->None:
+        import io
+        import matplotlib
+        fig   = anim._fig
+        width = int(fig.get_figwidth()*self.dpi)
+        # as Animation.save does: frames are drawn without blitting and at the size of the figure
+        with matplotlib.rc_context({"savefig.bbox": None}):
+            anim._init_draw()
+            for index, frame_data in enumerate(anim.new_saved_frame_seq()):
+                if (index >= self.last):
+                    break
+                # frames before the range are updated without drawing, update functions may build on previous frames
+                anim._draw_frame(frame_data)
+                if (index >= self.first):
+                    buffer = io.BytesIO()
+                    fig.savefig(buffer, format="rgba", dpi=self.dpi)
+                    rgba = np.frombuffer(buffer.getbuffer(), dtype=np.uint8).reshape(-1, width, 4)
+                    self.size = (width, rgba.shape[0])
+                    self.frames.append(rgba[..., :3].tobytes())
+
+def export_worker_init()->None:
+    # export workers never open windows
+    os.environ["MPLBACKEND"] = "Agg"
+    if ("matplotlib" in sys.modules):
+        sys.modules["matplotlib"].use("Agg")
+
+def export_frames_job(plot_cmd:str, shared_data:dict, key:str, first:int, last:int, dpi:float)->tuple:
+    # runs inside an export worker, returns the size and the rgb24 frames [first, last)
+    plot_data, shm_handles = map_payloads(shared_data)
+    frames = FrameRange(first, last, dpi)
+    plot_data[key] = frames
+    error_msg = eval_in_worker(plot_cmd, plot_data, shm_handles)
+    if (error_msg is not None):
+        raise RuntimeError(str(error_msg))
+    if (len(frames.frames) != (last - first)):
+        raise RuntimeError(f"rendered {len(frames.frames)} of the frames {first} to {last}, was {key}.save called?")
+    return frames.size, frames.frames
+
+class AnimationEncoder:
+    # frames are piped to ffmpeg when it is on the PATH, gifs fall back to Pillow without it
+    def __init__(self, path:str, size:tuple, fps:float):
+        self.path   = path
+        self.size   = size
+        self.fps    = fps
+        self.proc   = None
+        self.images = []
+        ffmpeg = shutil.which("ffmpeg")
+        is_gif = path.lower().endswith(".gif")
+        if (ffmpeg is not None):
+            args = [ffmpeg, "-y", "-loglevel", "error", "-f", "rawvideo", "-pix_fmt", "rgb24",
+                    "-s", f"{size[0]}x{size[1]}", "-r", f"{fps}", "-i", "-"]
+            if (is_gif):
+                args += ["-vf", "split[a][b];[a]palettegen[p];[b][p]paletteuse"]
+            else:
+                # yuv420p, which every player decodes, needs even sizes
+                args += ["-vf", "pad=ceil(iw/2)*2:ceil(ih/2)*2", "-pix_fmt", "yuv420p"]
+            self.proc = subprocess.Popen(args + [path], stdin=subprocess.PIPE, stderr=subprocess.PIPE)
+        elif (not is_gif):
+            raise RuntimeError(f"ffmpeg is needed to write {path}, only gifs are written without it")
+
+    def write(self, frame:bytes)->None:
+        if (self.proc is not None):
+            self.proc.stdin.write(frame)
+        else:
+            from PIL import Image
+            self.images.append(Image.frombytes("RGB", self.size, frame))
+
+    def close(self)->None:
+        if (self.proc is not None):
+            self.proc.stdin.close()
+            error = self.proc.stderr.read().decode("utf-8", "replace").strip()
+            if (self.proc.wait() != 0):
+                raise RuntimeError(f"ffmpeg failed: {error}")
+        elif (len(self.images) > 0):
+            self.images[0].save(self.path, save_all=True, append_images=self.images[1:],
+                                duration=int(round(1000.0/self.fps)), loop=0)
+
+def encode_animation(job:AnimationExport, futures:list, shm_handles:list, path:str, fps:float, t_start:float)->None:
+    # encoder thread of one export, takes the frame ranges in order while the workers render the next ones
+    encoder  = None
+    n_frames = 0
+    try:
+        for future in futures:
+            size, frames = future.result()
+            if (encoder is None):
+                encoder = AnimationEncoder(path, size, fps)
+            for frame in frames:
+                encoder.write(frame)
+            n_frames += len(frames)
+        if (encoder is None):
+            raise RuntimeError("the animation has no frames")
+        encoder.close()
+        encoder = None
+        print(f"[INFO] exported {n_frames} frames to {path}")
+        job.notify(f"done|{path}|{n_frames}|{time.monotonic() - t_start:.3f}")
+    except Exception as e:
+        for future in futures:
+            future.cancel()
+        if ((encoder is not None) and (encoder.proc is not None)):
+            encoder.proc.kill()
+        print(f"[Error] exporting {path} failed: {e}")
+        job.notify(f"failed|{e}")
+    finally:
+        for shm in shm_handles:
+            shm.close()
+            shm.unlink()
+
+def start_export_pool(n_workers:int)->None:
+    global export_pool
+    export_pool = ProcessPoolExecutor(max_workers=n_workers, initializer=export_worker_init)
+
+    # spawn every worker now, before the zmq threads exist
+    for future in [export_pool.submit(int, 0) for _ in range(n_workers)]:
+        future.result()
+    print(f"[INFO] animation export pool started with {n_workers} workers")
+
 def exit_handler(exit_code):
     global kill_thread
     kill_thread = True
+    if (render_pool is not None):
+        render_pool.shutdown(wait=True)
+    if (export_pool is not None):
+        # exports still running are abandoned, their files are incomplete
+        export_pool.shutdown(wait=True, cancel_futures=True)
     print("[INFO] requested to shutdown, goodbye!")
 
 def run_main():
-    global parsed_msgs
+    global parsed_msgs, reply_socket
+    if (cmd_args.reply_addr != ""):
+        reply_socket = zmq.Context.instance().socket(zmq.PUSH)
+        reply_socket.setsockopt(zmq.LINGER, 0)
+        reply_socket.connect(cmd_args.reply_addr)
     cmd_handler = {}
     cmd_handler["plot"] = plot_handler
+    if (render_pool is not None):
+        cmd_handler["plot"] = batch_plot_handler
+    cmd_handler["artist"] = artist_handler
     cmd_handler["exit"] = exit_handler
 
     print(f"[INFO] plotting server initialized")
+    next_stats_log = time.monotonic() + cmd_args.stats_interval
     try:
         while(not kill_thread):
-            if (not parsed_msgs.empty()):
-                msg = parsed_msgs.get_nowait()
-                parsed_msgs.task_done()
-                func = cmd_handler[msg[0]]
-                func(*(msg[1:]))
+            if ((cmd_args.stats_interval > 0) and (time.monotonic() >= next_stats_log)):
+                log_stats()
+                next_stats_log = time.monotonic() + cmd_args.stats_interval
+            if (parent_gone and recv_msgs.empty() and parsed_msgs.empty()):
+                print("[INFO] client is gone")
+                exit_handler(0)
+                break
+            try:
+                msg = parsed_msgs.get(timeout=0.05)
+            except Empty:
+                continue
+            parsed_msgs.task_done()
+            func = cmd_handler[msg[0]]
+            func(*(msg[1:]))
     except KeyboardInterrupt:
         print("[Warning] received keyboardInterrupt, killing plotting server")
         exit_handler(0)
 
 #### main ####
 if __name__ == '__main__':
-    addr = "tcp://127.0.0.1:5555"
-    if (len(sys.argv) > 1):
-        addr = sys.argv[1]
-    
+    addr = cmd_args.addr
+    if (cmd_args.headless and (cmd_args.workers > 0)):
+        start_render_pool(cmd_args.workers)
+    if (cmd_args.export_workers > 0):
+        start_export_pool(cmd_args.export_workers)
+
     sub_thread = Thread(target=subscriber, args=[addr])
     parser_thread = Thread(target=parse_msgs)
 
@@ -0,0 +1,165 @@
+#ifndef _CPPYPLOT_STATS_H_
+#define _CPPYPLOT_STATS_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace Cppyplot
+{
+
+// wall clock, timestamps are sent to the server and compared with its clock
+using frame_clock = std::chrono::system_clock;
+
+inline std::uint64_t to_wire_time(frame_clock::time_point t) noexcept
+{ return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count()); }
+
+inline std::uint64_t elapsed_ns(frame_clock::time_point since) noexcept
+{
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(frame_clock::now() - since).count();
+  return (elapsed > 0) ? static_cast<std::uint64_t>(elapsed) : 0u;
+}
+
+struct latency_summary{
+  std::uint64_t count = 0u;
+  std::chrono::nanoseconds mean{0};
+  std::chrono::nanoseconds p50{0};
+  std::chrono::nanoseconds p99{0};
+  std::chrono::nanoseconds max{0};
+};
+
+/*
+  * Lock-free latency histogram, safe to record from any number of threads.
+  * Values below 16ns get a bucket each, above that every power of two is split
+  * into 8 linear buckets, so percentiles are within ~6% of the recorded value.
+*/
+class latency_histogram{
+  private:
+    static constexpr std::size_t n_linear_  = 16u;
+    static constexpr std::size_t sub_bits_  = 3u;
+    static constexpr std::size_t n_buckets_ = n_linear_ + (64u - 4u)*(1u << sub_bits_);
+    std::array<std::atomic<std::uint64_t>, n_buckets_> counts_{};
+    std::atomic<std::uint64_t> total_{0u};
+    std::atomic<std::uint64_t> sum_{0u};
+    std::atomic<std::uint64_t> max_{0u};
+
+    static std::size_t msb(std::uint64_t value) noexcept
+    {
+      std::size_t bit = 0u;
+      while ((value >>= 1u) != 0u)
+      { bit++; }
+      return bit;
+    }
+
+    static std::size_t bucket(std::uint64_t value) noexcept
+    {
+      if (value < n_linear_)
+      { return static_cast<std::size_t>(value); }
+      std::size_t top = msb(value);
+      std::size_t sub = static_cast<std::size_t>(value >> (top - sub_bits_)) & ((1u << sub_bits_) - 1u);
+      return n_linear_ + (top - 4u)*(1u << sub_bits_) + sub;
+    }
+
+    // middle of the value range covered by the bucket
+    static std::uint64_t bucket_value(std::size_t idx) noexcept
+    {
+      if (idx < n_linear_)
+      { return idx; }
+      std::size_t top   = (idx - n_linear_)/(1u << sub_bits_) + 4u;
+      std::size_t sub   = (idx - n_linear_)%(1u << sub_bits_);
+      std::uint64_t width = std::uint64_t{1u} << (top - sub_bits_);
+      return ((std::uint64_t{1u} << sub_bits_) + sub)*width + width/2u;
+    }
+
+  public:
+    void record(std::uint64_t value_ns) noexcept
+    {
+      counts_[bucket(value_ns)].fetch_add(1u, std::memory_order_relaxed);
+      total_.fetch_add(1u, std::memory_order_relaxed);
+      sum_.fetch_add(value_ns, std::memory_order_relaxed);
+      std::uint64_t current_max = max_.load(std::memory_order_relaxed);
+      while ((value_ns > current_max) && !max_.compare_exchange_weak(current_max, value_ns, std::memory_order_relaxed))
+      { }
+    }
+
+    latency_summary summary() const noexcept
+    {
+      latency_summary out;
+      out.count = total_.load(std::memory_order_relaxed);
+      if (out.count == 0u)
+      { return out; }
+
+      out.mean = std::chrono::nanoseconds(sum_.load(std::memory_order_relaxed)/out.count);
+      out.max  = std::chrono::nanoseconds(max_.load(std::memory_order_relaxed));
+
+      // counts are read while other threads record, rank is clamped to what was seen
+      const std::uint64_t rank_p50 = (out.count + 1u)/2u;
+      const std::uint64_t rank_p99 = out.count - out.count/100u;
+      std::uint64_t seen = 0u;
+      bool has_p50 = false;
+      for (std::size_t i = 0u; i < n_buckets_; i++)
+      {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if ((has_p50 == false) && (seen >= rank_p50))
+        { out.p50 = std::chrono::nanoseconds(bucket_value(i)); has_p50 = true; }
+        if (seen >= rank_p99)
+        { out.p99 = std::chrono::nanoseconds(bucket_value(i)); break; }
+      }
+      out.p50 = std::min(out.p50, out.max);
+      out.p99 = std::min(std::max(out.p99, out.p50), out.max);
+      return out;
+    }
+
+    void reset() noexcept
+    {
+      for (auto& count : counts_)
+      { count.store(0u, std::memory_order_relaxed); }
+      total_.store(0u, std::memory_order_relaxed);
+      sum_.store(0u, std::memory_order_relaxed);
+      max_.store(0u, std::memory_order_relaxed);
+    }
+};
+
+/*
+  * Client side view of one session since it started (or since the last reset_stats).
+  * serialize:  packing all parts of a plot and pushing them into the session, per frame
+  * publish:    submission until the forwarder hands the frame to the zmq publisher
+  * round_trip: submission until every variable requested with raw_recv/data_recv is received
+  * End-to-end render latency and frames dropped on the way are measured by the server,
+  * see the [STATS] line printed by the python server.
+*/
+struct session_stats{
+  std::uint64_t frames_sent   = 0u;
+  std::uint64_t frames_queued = 0u;  // submitted but not yet published
+  std::uint64_t bytes_sent    = 0u;
+  std::uint64_t server_restarts = 0u;
+  double        frames_per_sec = 0.0;
+  double        bytes_per_sec  = 0.0;
+  latency_summary serialize;
+  latency_summary publish;
+  latency_summary round_trip;
+};
+
+inline std::ostream& operator<<(std::ostream& out, const latency_summary& latency)
+{
+  using us = std::chrono::duration<double, std::micro>;
+  out << "p50=" << us(latency.p50).count() << "us p99=" << us(latency.p99).count()
+      << "us max=" << us(latency.max).count() << "us (n=" << latency.count << ")";
+  return out;
+}
+
+inline std::ostream& operator<<(std::ostream& out, const session_stats& stats)
+{
+  out << "frames=" << stats.frames_sent << " (" << stats.frames_per_sec << "/s) queued=" << stats.frames_queued
+      << " restarts=" << stats.server_restarts
+      << " sent=" << stats.bytes_per_sec/1.0e6 << "MB/s"
+      << " | serialize " << stats.serialize << " | publish " << stats.publish << " | round_trip " << stats.round_trip;
+  return out;
+}
+
+}
+
+#endif
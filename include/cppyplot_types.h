@@ -1,6 +1,11 @@
 #ifndef _CPPYPLOT_TYPES_H_
 #define _CPPYPLOT_TYPES_H_
 
+#include <cstddef>
+
+namespace Cppyplot
+{
+
 template<typename T, char str>
 struct ValType{
   const static std::size_t elem_size = sizeof(T);
@@ -63,4 +68,6 @@ template<>
 constexpr auto unpack_type<double> ()
 {  return ValType<double, 'd'>{};  }
 
+}
+
 #endif
@@ -0,0 +1,222 @@
+#ifndef _CPPYPLOT_ZOOM_H_
+#define _CPPYPLOT_ZOOM_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <zmq.hpp>
+
+namespace Cppyplot
+{
+
+/*
+  * Series of samples kept in c++ that the server plots at screen resolution. A min/max segment tree over
+  * blocks of samples is built once, whenever the x limits of the axes change the server asks for the
+  * visible range and gets the min and max of every pixel column, or the raw samples once few enough are visible.
+  * x is either x0 + i*dx or an increasing array of the same length as the samples.
+  * The samples (and x) are not copied, they have to outlive the series unchanged.
+*/
+template<typename T>
+class zoom_series{
+  private:
+    // samples per leaf of the segment tree, scanned directly at the edges of a query
+    static constexpr std::size_t leaf_size = 256u;
+
+    using range_t = std::pair<T, T>;
+
+    const T*      y_;
+    const double* x_ = nullptr;
+    std::size_t   n_;
+    double        x0_ = 0.0, dx_ = 1.0;
+    std::size_t   n_leaves_ = 0u;
+    std::vector<range_t> nodes_;   // nodes_[n_leaves_ + leaf] are the leaves, nodes_[i] combines 2i and 2i + 1
+    std::uint64_t provider_id_ = 0u;
+
+    static range_t combine(const range_t& a, const range_t& b) noexcept
+    { return range_t{(b.first < a.first) ? b.first : a.first, (a.second < b.second) ? b.second : a.second}; }
+
+    range_t scan(std::size_t begin, std::size_t end) const noexcept
+    {
+      range_t out{y_[begin], y_[begin]};
+      for (std::size_t i = begin + 1u; i < end; i++)
+      {
+        out.first  = (y_[i] < out.first)  ? y_[i] : out.first;
+        out.second = (out.second < y_[i]) ? y_[i] : out.second;
+      }
+      return out;
+    }
+
+    void build()
+    {
+      n_leaves_ = (n_ + leaf_size - 1u)/leaf_size;
+      nodes_.resize(2u*n_leaves_);
+
+      // leaves cover all the samples, split across threads for long series
+      const std::size_t n_threads = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u),
+                                                          n_/(std::size_t{1u} << 22u));
+      auto fill_leaves = [this](std::size_t begin, std::size_t end)
+      {
+        for (std::size_t leaf = begin; leaf < end; leaf++)
+        { nodes_[n_leaves_ + leaf] = scan(leaf*leaf_size, std::min(n_, (leaf + 1u)*leaf_size)); }
+      };
+      if (n_threads <= 1u)
+      { fill_leaves(0u, n_leaves_); }
+      else
+      {
+        const std::size_t chunk = n_leaves_/n_threads;
+        std::vector<std::thread> workers;
+        workers.reserve(n_threads - 1u);
+        for (std::size_t t = 1u; t < n_threads; t++)
+        { workers.emplace_back(fill_leaves, t*chunk, (t + 1u == n_threads) ? n_leaves_ : (t + 1u)*chunk); }
+        fill_leaves(0u, chunk);
+        for (auto& worker : workers)
+        { worker.join(); }
+      }
+
+      for (std::size_t i = n_leaves_ - 1u; i > 0u; i--)
+      { nodes_[i] = combine(nodes_[2u*i], nodes_[2u*i + 1u]); }
+    }
+
+    // index of the first sample at or after value on the x axis
+    std::size_t lower_index(double value) const
+    {
+      if (x_ != nullptr)
+      { return static_cast<std::size_t>(std::lower_bound(x_, x_ + n_, value) - x_); }
+      const double pos = std::ceil((value - x0_)/dx_);
+      return (pos <= 0.0) ? 0u : ((pos >= static_cast<double>(n_)) ? n_ : static_cast<std::size_t>(pos));
+    }
+
+  public:
+    using value_type = T;
+
+    zoom_series(const T* y, std::size_t n, double x0 = 0.0, double dx = 1.0)
+      : y_(y), n_(n), x0_(x0), dx_(dx)
+    {
+      static_assert(std::is_arithmetic_v<T>, "zoom_series holds integral and floating point samples");
+      if ((n == 0u) || (!(dx > 0.0)))
+      { throw std::invalid_argument("cppyplot: zoom_series needs samples and a positive dx"); }
+      build();
+      provider_id_ = data_providers::add([this](const std::vector<std::string>& args, std::vector<zmq::message_t>& reply)
+      { serve_range(args, reply); });
+    }
+
+    // x has to be increasing
+    zoom_series(const double* x, const T* y, std::size_t n)
+      : y_(y), x_(x), n_(n)
+    {
+      static_assert(std::is_arithmetic_v<T>, "zoom_series holds integral and floating point samples");
+      if (n == 0u)
+      { throw std::invalid_argument("cppyplot: zoom_series needs samples"); }
+      build();
+      provider_id_ = data_providers::add([this](const std::vector<std::string>& args, std::vector<zmq::message_t>& reply)
+      { serve_range(args, reply); });
+    }
+
+    zoom_series(const zoom_series& other) = delete;
+    zoom_series& operator=(const zoom_series& other) = delete;
+
+    ~zoom_series()
+    { data_providers::remove(provider_id_); }
+
+    std::size_t size() const noexcept
+    { return n_; }
+
+    double x(std::size_t i) const noexcept
+    { return (x_ != nullptr) ? x_[i] : x0_ + static_cast<double>(i)*dx_; }
+
+    std::uint64_t provider_id() const noexcept
+    { return provider_id_; }
+
+    // min and max of the samples [begin, end), end > begin
+    std::pair<T, T> minmax(std::size_t begin, std::size_t end) const
+    {
+      if ((begin >= end) || (end > n_))
+      { throw std::out_of_range("cppyplot: zoom_series::minmax outside of the series"); }
+
+      const std::size_t first_leaf = (begin + leaf_size - 1u)/leaf_size;
+      const std::size_t last_leaf  = end/leaf_size;
+      if (first_leaf >= last_leaf)
+      { return scan(begin, end); }
+
+      range_t out = nodes_[n_leaves_ + first_leaf];
+      for (std::size_t l = n_leaves_ + first_leaf + 1u, r = n_leaves_ + last_leaf; l < r; l /= 2u, r /= 2u)
+      {
+        if ((l & 1u) != 0u)
+        { out = combine(out, nodes_[l++]); }
+        if ((r & 1u) != 0u)
+        { out = combine(out, nodes_[--r]); }
+      }
+      if (begin < first_leaf*leaf_size)
+      { out = combine(out, scan(begin, first_leaf*leaf_size)); }
+      if (last_leaf*leaf_size < end)
+      { out = combine(out, scan(last_leaf*leaf_size, end)); }
+      return out;
+    }
+
+    /*
+      * range|<x lo>|<x hi>|<pixels> is answered with ok|<shape>|raw or ok|<shape>|envelope, x as float64 and y.
+      * The range includes one sample beyond each limit so the line reaches the edges of the axes.
+      * An envelope has a min and a max point per pixel column with samples, both at the x of its first sample
+    */
+    void serve_range(const std::vector<std::string>& args, std::vector<zmq::message_t>& reply) const
+    {
+      if ((args.size() != 4u) || (args[0] != "range"))
+      { throw std::invalid_argument("zoom_series only serves range|<x lo>|<x hi>|<pixels>"); }
+      const double x_lo = std::stod(args[1]), x_hi = std::stod(args[2]);
+      const std::size_t n_px = std::max<std::size_t>(std::stoull(args[3]), 1u);
+      if (!(x_lo < x_hi))
+      { throw std::invalid_argument("zoom_series needs x lo < x hi"); }
+
+      std::size_t begin = lower_index(x_lo);
+      std::size_t end   = std::min(n_, lower_index(x_hi) + 1u);
+      begin = (begin > 0u) ? begin - 1u : 0u;
+      if (end <= begin)
+      { end = std::min(n_, begin + 1u); }
+
+      std::vector<double> x_out;
+      std::vector<T>      y_out;
+      const bool raw = ((end - begin) <= 2u*n_px);
+      if (raw == true)
+      {
+        x_out.reserve(end - begin);
+        for (std::size_t i = begin; i < end; i++)
+        { x_out.push_back(x(i)); }
+        y_out.assign(y_ + begin, y_ + end);
+      }
+      else
+      {
+        x_out.reserve(2u*n_px);
+        y_out.reserve(2u*n_px);
+        // pixel columns of the axes, the samples beyond the limits join the first and last column
+        const double px_width = (x_hi - x_lo)/static_cast<double>(n_px);
+        std::size_t bucket_begin = begin;
+        for (std::size_t px = 1u; (px <= n_px) && (bucket_begin < end); px++)
+        {
+          const std::size_t bucket_end = (px == n_px) ? end
+                                                      : std::clamp(lower_index(x_lo + static_cast<double>(px)*px_width), bucket_begin, end);
+          if (bucket_end == bucket_begin)
+          { continue; }
+          const range_t bucket = minmax(bucket_begin, bucket_end);
+          x_out.insert(x_out.end(), 2u, x(bucket_begin));
+          y_out.push_back(bucket.first);
+          y_out.push_back(bucket.second);
+          bucket_begin = bucket_end;
+        }
+      }
+
+      reply.emplace_back("ok|(" + std::to_string(y_out.size()) + ",)|" + ((raw == true) ? "raw" : "envelope"));
+      reply.emplace_back(x_out.data(), sizeof(double)*x_out.size());
+      reply.emplace_back(y_out.data(), sizeof(T)*y_out.size());
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,4 @@
+// Compiled component of cppyplot, built by CMake when CPPYPLOT_COMPILED_LIB is ON.
+// Every non-template definition of the header is compiled here once instead of in every translation unit.
+#include "cppyplot.hpp"
+#include "cppyplot_impl.h"